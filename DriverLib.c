@@ -6,10 +6,36 @@
 #include <Library/BaseMemoryLib.h>
 #include <Library/BaseLib.h>
 #include <Library/UefiBootServicesTableLib.h>
+#include <Library/TimerLib.h>
+#include <Library/PcdLib.h>
 #include <Protocol/SdMmcPassThru.h>
 #include <Protocol/SpiHc.h>
 
 // Use these standardized implementations instead of multiple versions
+
+//
+// CRC7 of every byte value, kept in the upper seven bits the way it goes on
+// the wire: entry i is the register after shifting i through x^7 + x^3 + 1.
+//
+STATIC CONST UINT8  mSdCardCrc7Table[256] = {
+  0x00, 0x12, 0x24, 0x36, 0x48, 0x5A, 0x6C, 0x7E, 0x90, 0x82, 0xB4, 0xA6, 0xD8, 0xCA, 0xFC, 0xEE,
+  0x32, 0x20, 0x16, 0x04, 0x7A, 0x68, 0x5E, 0x4C, 0xA2, 0xB0, 0x86, 0x94, 0xEA, 0xF8, 0xCE, 0xDC,
+  0x64, 0x76, 0x40, 0x52, 0x2C, 0x3E, 0x08, 0x1A, 0xF4, 0xE6, 0xD0, 0xC2, 0xBC, 0xAE, 0x98, 0x8A,
+  0x56, 0x44, 0x72, 0x60, 0x1E, 0x0C, 0x3A, 0x28, 0xC6, 0xD4, 0xE2, 0xF0, 0x8E, 0x9C, 0xAA, 0xB8,
+  0xC8, 0xDA, 0xEC, 0xFE, 0x80, 0x92, 0xA4, 0xB6, 0x58, 0x4A, 0x7C, 0x6E, 0x10, 0x02, 0x34, 0x26,
+  0xFA, 0xE8, 0xDE, 0xCC, 0xB2, 0xA0, 0x96, 0x84, 0x6A, 0x78, 0x4E, 0x5C, 0x22, 0x30, 0x06, 0x14,
+  0xAC, 0xBE, 0x88, 0x9A, 0xE4, 0xF6, 0xC0, 0xD2, 0x3C, 0x2E, 0x18, 0x0A, 0x74, 0x66, 0x50, 0x42,
+  0x9E, 0x8C, 0xBA, 0xA8, 0xD6, 0xC4, 0xF2, 0xE0, 0x0E, 0x1C, 0x2A, 0x38, 0x46, 0x54, 0x62, 0x70,
+  0x82, 0x90, 0xA6, 0xB4, 0xCA, 0xD8, 0xEE, 0xFC, 0x12, 0x00, 0x36, 0x24, 0x5A, 0x48, 0x7E, 0x6C,
+  0xB0, 0xA2, 0x94, 0x86, 0xF8, 0xEA, 0xDC, 0xCE, 0x20, 0x32, 0x04, 0x16, 0x68, 0x7A, 0x4C, 0x5E,
+  0xE6, 0xF4, 0xC2, 0xD0, 0xAE, 0xBC, 0x8A, 0x98, 0x76, 0x64, 0x52, 0x40, 0x3E, 0x2C, 0x1A, 0x08,
+  0xD4, 0xC6, 0xF0, 0xE2, 0x9C, 0x8E, 0xB8, 0xAA, 0x44, 0x56, 0x60, 0x72, 0x0C, 0x1E, 0x28, 0x3A,
+  0x4A, 0x58, 0x6E, 0x7C, 0x02, 0x10, 0x26, 0x34, 0xDA, 0xC8, 0xFE, 0xEC, 0x92, 0x80, 0xB6, 0xA4,
+  0x78, 0x6A, 0x5C, 0x4E, 0x30, 0x22, 0x14, 0x06, 0xE8, 0xFA, 0xCC, 0xDE, 0xA0, 0xB2, 0x84, 0x96,
+  0x2E, 0x3C, 0x0A, 0x18, 0x66, 0x74, 0x42, 0x50, 0xBE, 0xAC, 0x9A, 0x88, 0xF6, 0xE4, 0xD2, 0xC0,
+  0x1C, 0x0E, 0x38, 0x2A, 0x54, 0x46, 0x70, 0x62, 0x8C, 0x9E, 0xA8, 0xBA, 0xC4, 0xD6, 0xE0, 0xF2,
+};
+
 /**
   Calculates CRC7 for SD card commands.
   Polynomial: x^7 + x^3 + 1 (0x89)
@@ -22,42 +48,64 @@ SdCardCalculateCrc7 (
   )
 {
   UINT8 Crc = 0;
-  UINTN i, j;
+  UINTN i;
 
   for (i = 0; i < Length; i++) {
-    Crc ^= Data[i];
-    for (j = 0; j < 8; j++) {
-      if (Crc & 0x80) {
-        Crc = (UINT8)((Crc << 1) ^ 0x89);
-      } else {
-        Crc = (UINT8)(Crc << 1);
-      }
-    }
+    Crc = mSdCardCrc7Table[Crc ^ Data[i]];
   }
 
-  // SD protocol requires CRC7 shifted left by 1 with stop bit
-  return (Crc << 1) | 0x01;
+  // CRC7 is already in bits 7:1; add the end bit
+  return Crc | 0x01;
 }
 
+//
+// CRC16 engines. All of them compute the same MSB-first CRC16-CCITT from a
+// given preset; SdCardInitializeCrc16 picks the fastest pair that passes the
+// self-test against the bitwise reference. Until then the reference runs.
+// Each engine has a copying twin that stores the bytes it folds in, so data
+// that is both moved and checked is only read from memory once.
+//
+typedef
+UINT16
+(EFIAPI *SD_CARD_CRC16_ENGINE) (
+  IN UINT16       Crc,
+  IN CONST UINT8  *Data,
+  IN UINTN        Length
+  );
+
+typedef
+UINT16
+(EFIAPI *SD_CARD_CRC16_COPY_ENGINE) (
+  IN  UINT16       Crc,
+  OUT UINT8        *Destination,
+  IN  CONST UINT8  *Source,
+  IN  UINTN        Length
+  );
+
+#define SD_CARD_CRC16_SLICES      8
+#define SD_CARD_CRC16_TEST_SIZE   (SD_BLOCK_SIZE + 64)
+
+STATIC UINT16  mSdCardCrc16Table[SD_CARD_CRC16_SLICES][256];
+
 /**
-  Calculates CRC16 for SD card data blocks.
-  Polynomial: x^16 + x^12 + x^5 + 1 (0x1021)
+  Bitwise CRC16 reference, one bit of input per iteration.
 **/
+STATIC
 UINT16
 EFIAPI
-SdCardCalculateCrc16 (
+SdCardCrc16Bitwise (
+  IN UINT16       Crc,
   IN CONST UINT8  *Data,
   IN UINTN        Length
   )
 {
-  UINT16 Crc = 0;
   UINTN i, j;
 
   for (i = 0; i < Length; i++) {
     Crc ^= (UINT16)Data[i] << 8;
     for (j = 0; j < 8; j++) {
       if (Crc & 0x8000) {
-        Crc = (UINT16)((Crc << 1) ^ 0x1021);
+        Crc = (UINT16)((Crc << 1) ^ CRC16_POLYNOMIAL);
       } else {
         Crc = (UINT16)(Crc << 1);
       }
@@ -67,6 +115,416 @@ SdCardCalculateCrc16 (
   return Crc;
 }
 
+/**
+  Copying twin of the bitwise reference.
+**/
+STATIC
+UINT16
+EFIAPI
+SdCardCrc16CopyBitwise (
+  IN  UINT16       Crc,
+  OUT UINT8        *Destination,
+  IN  CONST UINT8  *Source,
+  IN  UINTN        Length
+  )
+{
+  CopyMem(Destination, Source, Length);
+  return SdCardCrc16Bitwise(Crc, Destination, Length);
+}
+
+/**
+  Folds eight bytes, given as two little-endian words in stream order, into
+  the CRC. Table k holds the CRC of a byte followed by k zero bytes, so the
+  eight lookups are independent of each other.
+**/
+STATIC
+UINT16
+SdCardCrc16Slice8 (
+  IN UINT16  Crc,
+  IN UINT32  Low,
+  IN UINT32  High
+  )
+{
+  CONST UINT16 (*Table)[256] = mSdCardCrc16Table;
+
+  return (UINT16)(Table[7][(UINT8)Low ^ (Crc >> 8)] ^ Table[6][(UINT8)(Low >> 8) ^ (Crc & 0xFF)] ^
+                  Table[5][(UINT8)(Low >> 16)] ^ Table[4][(UINT8)(Low >> 24)] ^
+                  Table[3][(UINT8)High] ^ Table[2][(UINT8)(High >> 8)] ^
+                  Table[1][(UINT8)(High >> 16)] ^ Table[0][(UINT8)(High >> 24)]);
+}
+
+/**
+  Slicing-by-8 CRC16.
+**/
+STATIC
+UINT16
+EFIAPI
+SdCardCrc16Sliced (
+  IN UINT16       Crc,
+  IN CONST UINT8  *Data,
+  IN UINTN        Length
+  )
+{
+  while (Length >= SD_CARD_CRC16_SLICES) {
+    Crc = SdCardCrc16Slice8(Crc, ReadUnaligned32((CONST UINT32 *)Data), ReadUnaligned32((CONST UINT32 *)(Data + 4)));
+    Data   += SD_CARD_CRC16_SLICES;
+    Length -= SD_CARD_CRC16_SLICES;
+  }
+
+  while (Length-- > 0) {
+    Crc = (UINT16)((Crc << 8) ^ mSdCardCrc16Table[0][(Crc >> 8) ^ *Data++]);
+  }
+
+  return Crc;
+}
+
+/**
+  Slicing-by-8 CRC16 that stores each word it has loaded.
+**/
+STATIC
+UINT16
+EFIAPI
+SdCardCrc16CopySliced (
+  IN  UINT16       Crc,
+  OUT UINT8        *Destination,
+  IN  CONST UINT8  *Source,
+  IN  UINTN        Length
+  )
+{
+  UINT32 Low;
+  UINT32 High;
+
+  while (Length >= SD_CARD_CRC16_SLICES) {
+    Low  = ReadUnaligned32((CONST UINT32 *)Source);
+    High = ReadUnaligned32((CONST UINT32 *)(Source + 4));
+    WriteUnaligned32((UINT32 *)Destination, Low);
+    WriteUnaligned32((UINT32 *)(Destination + 4), High);
+    Crc = SdCardCrc16Slice8(Crc, Low, High);
+    Source      += SD_CARD_CRC16_SLICES;
+    Destination += SD_CARD_CRC16_SLICES;
+    Length      -= SD_CARD_CRC16_SLICES;
+  }
+
+  while (Length-- > 0) {
+    *Destination++ = *Source;
+    Crc = (UINT16)((Crc << 8) ^ mSdCardCrc16Table[0][(Crc >> 8) ^ *Source++]);
+  }
+
+  return Crc;
+}
+
+#if defined (MDE_CPU_X64)
+//
+// Folding constants x^128 mod P and x^192 mod P, in that order
+//
+STATIC UINT64  mSdCardCrc16FoldConstants[2];
+
+/**
+  Folds 16-byte blocks into a 128-bit remainder with PCLMULQDQ.
+  State is the remainder as a 128-bit polynomial, low qword first; each
+  block is multiplied through by x^128 and added in.
+  Implemented in X64/SdCardCrc16Clmul.nasm.
+**/
+VOID
+EFIAPI
+SdCardCrc16FoldClmul (
+  IN OUT UINT64       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        Blocks,
+  IN     CONST UINT64 *Constants
+  );
+
+/**
+  SdCardCrc16FoldClmul that also stores each block at Destination.
+  Implemented in X64/SdCardCrc16Clmul.nasm.
+**/
+VOID
+EFIAPI
+SdCardCrc16FoldCopyClmul (
+  IN OUT UINT64       *State,
+  OUT    UINT8        *Destination,
+  IN     CONST UINT8  *Source,
+  IN     UINTN        Blocks,
+  IN     CONST UINT64 *Constants
+  );
+
+/**
+  Returns x^Power mod P for the CRC16 polynomial.
+**/
+STATIC
+UINT16
+SdCardCrc16XPowMod (
+  IN UINTN  Power
+  )
+{
+  UINT32 Remainder;
+
+  Remainder = 1;
+  while (Power-- > 0) {
+    Remainder <<= 1;
+    if (Remainder & BIT16) {
+      Remainder ^= BIT16 | CRC16_POLYNOMIAL;
+    }
+  }
+
+  return (UINT16)Remainder;
+}
+
+/**
+  Loads the first 16-byte block as the folding remainder. The preset CRC
+  adds into its top 16 bits.
+**/
+STATIC
+VOID
+SdCardCrc16ClmulLoad (
+  OUT UINT64       *State,
+  IN  UINT16       Crc,
+  IN  CONST UINT8  *Data
+  )
+{
+  State[1] = SwapBytes64(ReadUnaligned64((CONST UINT64 *)Data)) ^ LShiftU64(Crc, 48);
+  State[0] = SwapBytes64(ReadUnaligned64((CONST UINT64 *)(Data + 8)));
+}
+
+/**
+  Reduces the 128-bit folding remainder to the CRC16 of the bytes folded.
+**/
+STATIC
+UINT16
+SdCardCrc16ClmulReduce (
+  IN CONST UINT64  *State
+  )
+{
+  UINT8 Remainder[16];
+
+  WriteUnaligned64((UINT64 *)Remainder, SwapBytes64(State[1]));
+  WriteUnaligned64((UINT64 *)(Remainder + 8), SwapBytes64(State[0]));
+  return SdCardCrc16Sliced(0, Remainder, sizeof(Remainder));
+}
+
+/**
+  Carry-less multiply CRC16. Whole 16-byte blocks are folded with
+  PCLMULQDQ; the 128-bit remainder and the tail go through the sliced
+  tables.
+**/
+STATIC
+UINT16
+EFIAPI
+SdCardCrc16Clmul (
+  IN UINT16       Crc,
+  IN CONST UINT8  *Data,
+  IN UINTN        Length
+  )
+{
+  UINT64 State[2];
+  UINTN  Blocks;
+
+  if (Length < 32) {
+    return SdCardCrc16Sliced(Crc, Data, Length);
+  }
+
+  Blocks = Length / 16;
+  SdCardCrc16ClmulLoad(State, Crc, Data);
+  SdCardCrc16FoldClmul(State, Data + 16, Blocks - 1, mSdCardCrc16FoldConstants);
+
+  Crc = SdCardCrc16ClmulReduce(State);
+  return SdCardCrc16Sliced(Crc, Data + Blocks * 16, Length - Blocks * 16);
+}
+
+/**
+  Carry-less multiply CRC16 that stores each block it has loaded.
+**/
+STATIC
+UINT16
+EFIAPI
+SdCardCrc16CopyClmul (
+  IN  UINT16       Crc,
+  OUT UINT8        *Destination,
+  IN  CONST UINT8  *Source,
+  IN  UINTN        Length
+  )
+{
+  UINT64 State[2];
+  UINTN  Blocks;
+
+  if (Length < 32) {
+    return SdCardCrc16CopySliced(Crc, Destination, Source, Length);
+  }
+
+  Blocks = Length / 16;
+  SdCardCrc16ClmulLoad(State, Crc, Source);
+  CopyMem(Destination, Source, 16);
+  SdCardCrc16FoldCopyClmul(State, Destination + 16, Source + 16, Blocks - 1, mSdCardCrc16FoldConstants);
+
+  Crc = SdCardCrc16ClmulReduce(State);
+  return SdCardCrc16CopySliced(Crc, Destination + Blocks * 16, Source + Blocks * 16, Length - Blocks * 16);
+}
+
+/**
+  Checks CPUID for PCLMULQDQ and the SSSE3 byte shuffle the kernel uses.
+**/
+STATIC
+BOOLEAN
+SdCardCpuHasClmul (
+  VOID
+  )
+{
+  UINT32 Ecx;
+
+  AsmCpuid(1, NULL, NULL, &Ecx, NULL);
+  return (BOOLEAN)((Ecx & BIT1) != 0 && (Ecx & BIT9) != 0);
+}
+#endif
+
+STATIC SD_CARD_CRC16_ENGINE       mSdCardCrc16Engine     = SdCardCrc16Bitwise;
+STATIC SD_CARD_CRC16_COPY_ENGINE  mSdCardCrc16CopyEngine = SdCardCrc16CopyBitwise;
+
+/**
+  Checks a CRC16 engine and its copying twin against the bitwise reference
+  on the standard check string and on every length and alignment of a
+  pseudo-random buffer that the data path can produce. The copy must also
+  match its source byte for byte.
+**/
+STATIC
+BOOLEAN
+SdCardCrc16SelfTest (
+  IN SD_CARD_CRC16_ENGINE       Engine,
+  IN SD_CARD_CRC16_COPY_ENGINE  CopyEngine
+  )
+{
+  STATIC CONST UINT8  Check[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+  STATIC UINT8        Pattern[SD_CARD_CRC16_TEST_SIZE];
+  STATIC UINT8        Copy[SD_CARD_CRC16_TEST_SIZE];
+  UINT32              Lfsr;
+  UINT16              Expected;
+  UINTN               Index;
+  UINTN               Offset;
+  UINTN               CopyOffset;
+  UINTN               Length;
+
+  if (Engine(0, Check, sizeof(Check)) != 0x31C3) {
+    return FALSE;
+  }
+
+  Lfsr = 0xACE1;
+  for (Index = 0; Index < sizeof(Pattern); Index++) {
+    Lfsr = (Lfsr >> 1) ^ ((Lfsr & 1) ? 0xB400 : 0);
+    Pattern[Index] = (UINT8)Lfsr;
+  }
+
+  for (Offset = 0; Offset < 16; Offset++) {
+    // Source and destination alignments differ for most offsets
+    CopyOffset = (Offset * 5) % 16;
+    for (Length = 0; MAX(Offset, CopyOffset) + Length <= sizeof(Pattern); Length += (Length < 64) ? 1 : 61) {
+      Expected = SdCardCrc16Bitwise(0x1D0F, Pattern + Offset, Length);
+      if (Engine(0x1D0F, Pattern + Offset, Length) != Expected) {
+        return FALSE;
+      }
+      SetMem(Copy, sizeof(Copy), 0);
+      if (CopyEngine(0x1D0F, Copy + CopyOffset, Pattern + Offset, Length) != Expected ||
+          CompareMem(Copy + CopyOffset, Pattern + Offset, Length) != 0) {
+        return FALSE;
+      }
+    }
+  }
+
+  return (BOOLEAN)(Engine(0, Pattern, SD_BLOCK_SIZE) == SdCardCrc16Bitwise(0, Pattern, SD_BLOCK_SIZE));
+}
+
+/**
+  Builds the CRC16 tables and selects the CRC16 engines for this CPU. Called
+  once from the driver entry point; an engine that fails its self-test is
+  never used.
+**/
+VOID
+EFIAPI
+SdCardInitializeCrc16 (
+  VOID
+  )
+{
+  UINTN  Index;
+  UINTN  Slice;
+  UINT8  Byte;
+  UINT16 Previous;
+
+  for (Index = 0; Index < 256; Index++) {
+    Byte = (UINT8)Index;
+    mSdCardCrc16Table[0][Index] = SdCardCrc16Bitwise(0, &Byte, 1);
+  }
+  for (Slice = 1; Slice < SD_CARD_CRC16_SLICES; Slice++) {
+    for (Index = 0; Index < 256; Index++) {
+      Previous = mSdCardCrc16Table[Slice - 1][Index];
+      mSdCardCrc16Table[Slice][Index] = (UINT16)((Previous << 8) ^ mSdCardCrc16Table[0][Previous >> 8]);
+    }
+  }
+
+  if (!SdCardCrc16SelfTest(SdCardCrc16Sliced, SdCardCrc16CopySliced)) {
+    DEBUG((DEBUG_ERROR, "SdCard: Sliced CRC16 failed its self-test, using the bitwise reference\n"));
+    return;
+  }
+  mSdCardCrc16Engine     = SdCardCrc16Sliced;
+  mSdCardCrc16CopyEngine = SdCardCrc16CopySliced;
+
+#if defined (MDE_CPU_X64)
+  if (SdCardCpuHasClmul()) {
+    mSdCardCrc16FoldConstants[0] = SdCardCrc16XPowMod(128);
+    mSdCardCrc16FoldConstants[1] = SdCardCrc16XPowMod(192);
+    if (SdCardCrc16SelfTest(SdCardCrc16Clmul, SdCardCrc16CopyClmul)) {
+      mSdCardCrc16Engine     = SdCardCrc16Clmul;
+      mSdCardCrc16CopyEngine = SdCardCrc16CopyClmul;
+    } else {
+      DEBUG((DEBUG_ERROR, "SdCard: PCLMULQDQ CRC16 failed its self-test\n"));
+    }
+  }
+#endif
+
+  DEBUG((DEBUG_INFO, "SdCard: CRC16 engine: %a\n",
+         (mSdCardCrc16Engine == SdCardCrc16Sliced) ? "sliced tables" : "PCLMULQDQ"));
+}
+
+/**
+  Calculates CRC16 for SD card data blocks.
+  Polynomial: x^16 + x^12 + x^5 + 1 (0x1021)
+**/
+UINT16
+EFIAPI
+SdCardCalculateCrc16 (
+  IN CONST UINT8  *Data,
+  IN UINTN        Length
+  )
+{
+  return mSdCardCrc16Engine(0, Data, Length);
+}
+
+/**
+  Continues a CRC16 over more data.
+**/
+UINT16
+EFIAPI
+SdCardUpdateCrc16 (
+  IN UINT16       Crc,
+  IN CONST UINT8  *Data,
+  IN UINTN        Length
+  )
+{
+  return mSdCardCrc16Engine(Crc, Data, Length);
+}
+
+/**
+  Copies data and continues a CRC16 over it in the same pass.
+**/
+UINT16
+EFIAPI
+SdCardCopyCrc16 (
+  IN  UINT16       Crc,
+  OUT VOID         *Destination,
+  IN  CONST VOID   *Source,
+  IN  UINTN        Length
+  )
+{
+  return mSdCardCrc16CopyEngine(Crc, (UINT8 *)Destination, (CONST UINT8 *)Source, Length);
+}
+
 /**
   Checks the Card Capacity Status (CCS) bit in the OCR register.
   @param[in] Ocr  OCR register value
@@ -231,6 +689,150 @@ SdCardMilliSecondDelay (
   gBS->Stall(Milliseconds * 1000);
 }
 
+/**
+  Decodes the CSD TRAN_SPEED field into a clock frequency.
+  Bits [2:0] select the rate unit (100 kbit/s to 100 Mbit/s) and bits [6:3]
+  the multiplier (1.0 to 8.0), so 0x32 is 25 MHz and 0x5A is 50 MHz.
+  @param[in] TranSpeed  TRAN_SPEED byte from the CSD register
+  @return Maximum data transfer clock in Hz, or 0 if the field is reserved
+**/
+UINT32
+EFIAPI
+SdCardDecodeTranSpeed (
+  IN UINT8  TranSpeed
+  )
+{
+  STATIC CONST UINT32 RateUnit[4] = { 10000, 100000, 1000000, 10000000 };
+  STATIC CONST UINT8  Multiplier[16] = { 0, 10, 12, 13, 15, 20, 25, 30, 35, 40, 45, 50, 55, 60, 70, 80 };
+  UINT8 Unit;
+  UINT8 Value;
+
+  Unit  = TranSpeed & 0x07;
+  Value = (TranSpeed >> 3) & 0x0F;
+  if (Unit >= ARRAY_SIZE (RateUnit) || Value == 0) {
+    return 0;
+  }
+
+  return RateUnit[Unit] * Multiplier[Value];
+}
+
+/**
+  Decodes the CSD TAAC field into a read access time.
+  Bits [2:0] select the time unit (1 ns to 10 ms) and bits [6:3] the same
+  multiplier table as TRAN_SPEED, so 0x0E is 1 ms.
+  @param[in] Taac  TAAC byte from the CSD register
+  @return Asynchronous part of the read access time in nanoseconds
+**/
+UINT32
+EFIAPI
+SdCardDecodeTaac (
+  IN UINT8  Taac
+  )
+{
+  STATIC CONST UINT32 TimeUnit[8] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000 };
+  STATIC CONST UINT8  Multiplier[16] = { 0, 10, 12, 13, 15, 20, 25, 30, 35, 40, 45, 50, 55, 60, 70, 80 };
+
+  return (TimeUnit[Taac & 0x07] * Multiplier[(Taac >> 3) & 0x0F]) / 10;
+}
+
+/**
+  Returns the microseconds elapsed since an ACMD41 polling loop started.
+  @param[in] StartNs  Loop start time in nanoseconds
+  @return Elapsed time in microseconds, saturated at MAX_UINT32
+**/
+UINT32
+EFIAPI
+SdCardOpCondElapsedUs (
+  IN UINT64  StartNs
+  )
+{
+  UINT64  ElapsedUs;
+
+  ElapsedUs = DivU64x32(GetTimeInNanoSecond(GetPerformanceCounter()) - StartNs, 1000);
+  return (ElapsedUs > MAX_UINT32) ? MAX_UINT32 : (UINT32)ElapsedUs;
+}
+
+/**
+  Schedules the next ACMD41 poll and doubles the interval after it.
+  The wait is clipped to the remaining PcdSdCardInitTimeoutMs budget so the
+  final poll lands on the deadline rather than up to an interval past it.
+  @param[in]     StartNs     Loop start time in nanoseconds
+  @param[in,out] IntervalUs  Current interval, updated for the next poll
+  @param[out]    WaitUs      Time to wait before the next poll
+  @retval EFI_SUCCESS  Poll again after WaitUs
+  @retval EFI_TIMEOUT  PcdSdCardInitTimeoutMs has elapsed
+**/
+EFI_STATUS
+EFIAPI
+SdCardOpCondSchedule (
+  IN     UINT64  StartNs,
+  IN OUT UINT32  *IntervalUs,
+  OUT    UINT32  *WaitUs
+  )
+{
+  UINT64  TimeoutUs;
+  UINT32  ElapsedUs;
+
+  TimeoutUs = MultU64x32(PcdGet32(PcdSdCardInitTimeoutMs), 1000);
+  ElapsedUs = SdCardOpCondElapsedUs(StartNs);
+  if (ElapsedUs >= TimeoutUs) {
+    return EFI_TIMEOUT;
+  }
+
+  *WaitUs = *IntervalUs;
+  if (*WaitUs > TimeoutUs - ElapsedUs) {
+    *WaitUs = (UINT32)(TimeoutUs - ElapsedUs);
+  }
+
+  *IntervalUs = MIN(*IntervalUs * 2, SD_OP_COND_POLL_MAX_US);
+  return EFI_SUCCESS;
+}
+
+/**
+  Waits out one ACMD41 polling interval and doubles the next one.
+  @param[in]     StartNs     Loop start time in nanoseconds
+  @param[in,out] IntervalUs  Current interval, updated for the next poll
+  @retval EFI_SUCCESS  Poll again
+  @retval EFI_TIMEOUT  PcdSdCardInitTimeoutMs has elapsed
+**/
+EFI_STATUS
+EFIAPI
+SdCardOpCondBackoff (
+  IN     UINT64  StartNs,
+  IN OUT UINT32  *IntervalUs
+  )
+{
+  EFI_STATUS  Status;
+  UINT32      WaitUs;
+
+  Status = SdCardOpCondSchedule(StartNs, IntervalUs, &WaitUs);
+  if (!EFI_ERROR(Status)) {
+    gBS->Stall(WaitUs);
+  }
+
+  return Status;
+}
+
+/**
+  Decodes the SD Status AU_SIZE field into an allocation unit size.
+  Values 1 to 9 double from 16 KB to 4 MB; larger values are the SDXC sizes
+  from 8 MB to 64 MB.
+  @param[in] AuSize  AU_SIZE nibble from the SD Status
+  @return Allocation unit size in KB, or 0 if not defined
+**/
+UINT32
+EFIAPI
+SdCardDecodeAuSize (
+  IN UINT8  AuSize
+  )
+{
+  STATIC CONST UINT32 AuSizeKb[16] = {
+    0, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 12288, 16384, 24576, 32768, 65536
+  };
+
+  return AuSizeKb[AuSize & 0x0F];
+}
+
 /**
   Converts a frequency in Hz to the closest SD clock divisor value.
   @param[in] BaseFrequency  Base frequency of the controller
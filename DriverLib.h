@@ -48,6 +48,14 @@ typedef struct _SD_CARD_PRIVATE_DATA SD_CARD_PRIVATE_DATA;
 #define R1_ADDRESS_ERROR         (1 << 5)
 #define R1_PARAMETER_ERROR       (1 << 6)
 
+//
+// ACMD41 Polling Intervals
+// Most cards leave the idle state within a few milliseconds, so polling
+// starts fine-grained and backs off towards the old fixed 10 ms interval.
+//
+#define SD_OP_COND_POLL_MIN_US   100
+#define SD_OP_COND_POLL_MAX_US   10000
+
 /**
   Checks the Card Capacity Status (CCS) bit in the OCR register.
   @param[in] Ocr  OCR register value
@@ -137,6 +145,80 @@ SdCardMilliSecondDelay (
   IN UINTN  Milliseconds
   );
 
+/**
+  Decodes the CSD TRAN_SPEED field into a clock frequency.
+  @param[in] TranSpeed  TRAN_SPEED byte from the CSD register
+  @return Maximum data transfer clock in Hz, or 0 if the field is reserved
+**/
+UINT32
+EFIAPI
+SdCardDecodeTranSpeed (
+  IN UINT8  TranSpeed
+  );
+
+/**
+  Decodes the CSD TAAC field into a read access time.
+  @param[in] Taac  TAAC byte from the CSD register
+  @return Asynchronous part of the read access time in nanoseconds
+**/
+UINT32
+EFIAPI
+SdCardDecodeTaac (
+  IN UINT8  Taac
+  );
+
+/**
+  Returns the microseconds elapsed since an ACMD41 polling loop started.
+  @param[in] StartNs  Loop start time in nanoseconds
+  @return Elapsed time in microseconds, saturated at MAX_UINT32
+**/
+UINT32
+EFIAPI
+SdCardOpCondElapsedUs (
+  IN UINT64  StartNs
+  );
+
+/**
+  Schedules the next ACMD41 poll and doubles the interval after it.
+  @param[in]     StartNs     Loop start time in nanoseconds
+  @param[in,out] IntervalUs  Current interval, updated for the next poll
+  @param[out]    WaitUs      Time to wait before the next poll
+  @retval EFI_SUCCESS  Poll again after WaitUs
+  @retval EFI_TIMEOUT  PcdSdCardInitTimeoutMs has elapsed
+**/
+EFI_STATUS
+EFIAPI
+SdCardOpCondSchedule (
+  IN     UINT64  StartNs,
+  IN OUT UINT32  *IntervalUs,
+  OUT    UINT32  *WaitUs
+  );
+
+/**
+  Waits out one ACMD41 polling interval and doubles the next one.
+  @param[in]     StartNs     Loop start time in nanoseconds
+  @param[in,out] IntervalUs  Current interval, updated for the next poll
+  @retval EFI_SUCCESS  Poll again
+  @retval EFI_TIMEOUT  PcdSdCardInitTimeoutMs has elapsed
+**/
+EFI_STATUS
+EFIAPI
+SdCardOpCondBackoff (
+  IN     UINT64  StartNs,
+  IN OUT UINT32  *IntervalUs
+  );
+
+/**
+  Decodes the SD Status AU_SIZE field into an allocation unit size.
+  @param[in] AuSize  AU_SIZE nibble from the SD Status
+  @return Allocation unit size in KB, or 0 if not defined
+**/
+UINT32
+EFIAPI
+SdCardDecodeAuSize (
+  IN UINT8  AuSize
+  );
+
 /**
   Converts a frequency in Hz to the closest SD clock divisor value.
   @param[in] BaseFrequency    Base frequency of the controller
@@ -233,6 +315,16 @@ SdCardCalculateCrc7 (
   IN UINTN        Length
   );
 
+/**
+  Builds the CRC16 tables and selects the fastest CRC16 engine that passes
+  its self-test on this CPU.
+**/
+VOID
+EFIAPI
+SdCardInitializeCrc16 (
+  VOID
+  );
+
 /**
   Calculates CRC16 for SD card data blocks.
   Polynomial: x^16 + x^12 + x^5 + 1 (0x1021)
@@ -246,4 +338,36 @@ SdCardCalculateCrc16 (
   IN CONST UINT8  *Data,
   IN UINTN        Length
   );
+
+/**
+  Continues a CRC16 over more data.
+  @param[in] Crc     CRC16 of the data before; 0 to start
+  @param[in] Data    Data to fold in
+  @param[in] Length  Length of data
+  @return CRC16 of everything so far
+**/
+UINT16
+EFIAPI
+SdCardUpdateCrc16 (
+  IN UINT16       Crc,
+  IN CONST UINT8  *Data,
+  IN UINTN        Length
+  );
+
+/**
+  Copies data and continues a CRC16 over it, reading the source only once.
+  @param[in]  Crc          CRC16 of the data before; 0 to start
+  @param[out] Destination  Receives the copy
+  @param[in]  Source       Data to copy and fold in
+  @param[in]  Length       Length of data
+  @return CRC16 of everything so far
+**/
+UINT16
+EFIAPI
+SdCardCopyCrc16 (
+  IN  UINT16       Crc,
+  OUT VOID         *Destination,
+  IN  CONST VOID   *Source,
+  IN  UINTN        Length
+  );
 #endif // __DRIVER_LIB_H__
\ No newline at end of file
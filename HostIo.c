@@ -2,6 +2,7 @@
 #include "SdCardBlockIo.h"
 #include "SdCardDxe.h"
 #include "SdCardMedia.h"
+#include "SdCardWarmBoot.h"
 #include "DriverLib.h"
 #include <Library/DebugLib.h>
 #include <Library/TimerLib.h>
@@ -500,20 +501,17 @@ ParseCsdRegister (
   return EFI_SUCCESS;
 }
 /**
-  Initializes the SD card in Host mode.
+  Resets the card with CMD0 and identifies it with CMD8 in Host mode.
+  The card is left in the idle state, ready for ACMD41.
 **/
 EFI_STATUS
 EFIAPI
-SdCardInitializeHost (
+SdCardIdentifyHost (
   IN SD_CARD_PRIVATE_DATA  *Private
   )
 {
   EFI_STATUS Status;
   UINT32 Response;
-  UINT32 Ocr;
-  UINTN Retry;
-  UINT16 Rca = 0;
-  UINT8 RegisterData[16]; // 128 bits for CSD/CID
   
   DEBUG((DEBUG_INFO, "SdCardHost: Starting host mode initialization\n"));
   
@@ -544,50 +542,82 @@ SdCardInitializeHost (
     }
   }
   
-  // ACMD41: Initialize the card (with HCS bit for SDv2+)
-  Retry = 100; // Retry up to 100 times (about 1 second)
-  do {
-    // First send CMD55 (APP_CMD) to indicate next command is application-specific
-    Status = SdCardSendCommandHost(Private, SD_CMD55_APP_CMD, 0, &Response);
-    if (EFI_ERROR(Status)) {
-      DEBUG((DEBUG_ERROR, "SdCardHost: CMD55 failed - %r\n", Status));
-      return Status;
-    }
-    
-    // Send ACMD41 with appropriate arguments
-    UINT32 Acmd41Arg = 0;
-    if (Private->CardType == CARD_TYPE_SD_V2_SC) {
-      Acmd41Arg = SD_HCS; // Set Host Capacity Support bit for SDv2+
-    }
-    
-    Status = SdCardSendCommandHost(Private, SD_ACMD41_SD_SEND_OP_COND, Acmd41Arg, &Response);
-    if (EFI_ERROR(Status)) {
-      DEBUG((DEBUG_ERROR, "SdCardHost: ACMD41 failed - %r\n", Status));
-      return Status;
-    }
-    
-    // Check if initialization is complete (power up bit set)
-    if (Response & OCR_POWERUP_BIT) {
-      Ocr = Response;
-      break;
-    }
-    
-    // Wait before retrying
-    gBS->Stall(10000); // 10ms delay
-    Retry--;
-  } while (Retry > 0);
+  return EFI_SUCCESS;
+}
+
+/**
+  Issues one round of CMD55 and ACMD41 in Host mode.
+  @param[in]  Private  SD card private data
+  @param[out] Ready    TRUE once the card reports power up complete
+  @return EFI_STATUS of the command exchange
+**/
+EFI_STATUS
+EFIAPI
+SdCardPollOpCondHost (
+  IN  SD_CARD_PRIVATE_DATA  *Private,
+  OUT BOOLEAN               *Ready
+  )
+{
+  EFI_STATUS Status;
+  UINT32 Response;
+  UINT32 Acmd41Arg;
   
-  if (Retry == 0) {
-    DEBUG((DEBUG_ERROR, "SdCardHost: ACMD41 timeout\n"));
-    return EFI_TIMEOUT;
+  *Ready = FALSE;
+  
+  // First send CMD55 (APP_CMD) to indicate next command is application-specific
+  Status = SdCardSendCommandHost(Private, SD_CMD55_APP_CMD, 0, &Response);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_ERROR, "SdCardHost: CMD55 failed - %r\n", Status));
+    return Status;
+  }
+  
+  // Send ACMD41 with appropriate arguments
+  Acmd41Arg = 0;
+  if (Private->CardType == CARD_TYPE_SD_V2_SC) {
+    Acmd41Arg = SD_HCS; // Set Host Capacity Support bit for SDv2+
   }
   
+  Status = SdCardSendCommandHost(Private, SD_ACMD41_SD_SEND_OP_COND, Acmd41Arg, &Response);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_ERROR, "SdCardHost: ACMD41 failed - %r\n", Status));
+    return Status;
+  }
+  
+  // Check if initialization is complete (power up bit set)
+  if ((Response & OCR_POWERUP_BIT) == 0) {
+    return EFI_SUCCESS;
+  }
+  
+  Private->Ocr[0] = (UINT8)(Response >> 24);
+  Private->Ocr[1] = (UINT8)(Response >> 16);
+  Private->Ocr[2] = (UINT8)(Response >> 8);
+  Private->Ocr[3] = (UINT8)Response;
+  
   // Check if card is high capacity
-  if (Ocr & OCR_CCS_BIT) {
+  if (Response & OCR_CCS_BIT) {
     Private->CardType = CARD_TYPE_SD_V2_HC;
     DEBUG((DEBUG_INFO, "SdCardHost: High capacity card detected\n"));
   }
   
+  *Ready = TRUE;
+  return EFI_SUCCESS;
+}
+
+/**
+  Finishes Host mode initialization once ACMD41 has completed: assigns the
+  RCA, reads the CID and CSD and selects the card.
+**/
+EFI_STATUS
+EFIAPI
+SdCardCompleteInitHost (
+  IN SD_CARD_PRIVATE_DATA  *Private
+  )
+{
+  EFI_STATUS Status;
+  UINT32 Response;
+  UINT16 Rca = 0;
+  UINT8 RegisterData[16]; // 128 bits for CSD/CID
+  
   // CMD2: Get CID
   Status = SdCardReadRegister(Private, SD_CMD2_ALL_SEND_CID, 0, RegisterData);
   if (EFI_ERROR(Status)) {
@@ -601,6 +631,8 @@ SdCardInitializeHost (
     DEBUG((DEBUG_WARN, "SdCardHost: CID parsing failed - %r\n", Status));
     // Continue anyway as this is not critical for operation
   }
+  CopyMem(Private->Cid, RegisterData, sizeof(Private->Cid));
+  SdCardMatchWarmBoot(Private);
   
   // CMD3: Get RCA (Relative Card Address)
   Status = SdCardSendCommandHost(Private, SD_CMD3_SEND_RELATIVE_ADDR, 0, &Response);
@@ -619,12 +651,17 @@ SdCardInitializeHost (
   Private->Rca = Rca;
   DEBUG((DEBUG_INFO, "SdCardHost: RCA assigned: 0x%04X\n", Rca));
   
-  // CMD9: Get CSD
-  Status = SdCardReadRegister(Private, SD_CMD9_SEND_CSD, Rca << 16, RegisterData);
-  if (EFI_ERROR(Status)) {
-    DEBUG((DEBUG_ERROR, "SdCardHost: CMD9 failed - %r\n", Status));
-    return Status;
+  // CMD9: Get CSD, unless this is the card remembered from last boot
+  if (Private->WarmBoot.Hit) {
+    CopyMem(RegisterData, Private->WarmBoot.Cached.Csd, sizeof(RegisterData));
+  } else {
+    Status = SdCardReadRegister(Private, SD_CMD9_SEND_CSD, Rca << 16, RegisterData);
+    if (EFI_ERROR(Status)) {
+      DEBUG((DEBUG_ERROR, "SdCardHost: CMD9 failed - %r\n", Status));
+      return Status;
+    }
   }
+  CopyMem(Private->WarmBoot.Csd, RegisterData, sizeof(Private->WarmBoot.Csd));
   
   // Parse CSD register to get capacity and other card information
   Status = ParseCsdRegister(Private, RegisterData);
@@ -660,6 +697,57 @@ SdCardInitializeHost (
   return EFI_SUCCESS;
 }
 
+/**
+  Initializes the SD card in Host mode.
+**/
+EFI_STATUS
+EFIAPI
+SdCardInitializeHost (
+  IN SD_CARD_PRIVATE_DATA  *Private
+  )
+{
+  EFI_STATUS Status;
+  BOOLEAN Ready;
+  UINT64 StartNs;
+  UINT32 IntervalUs;
+  UINT32 Polls;
+  
+  Status = SdCardIdentifyHost(Private);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  
+  // ACMD41: Initialize the card (with HCS bit for SDv2+), polling quickly at
+  // first and backing off until PcdSdCardInitTimeoutMs runs out
+  StartNs = GetTimeInNanoSecond(GetPerformanceCounter());
+  IntervalUs = SD_OP_COND_POLL_MIN_US;
+  Polls = 0;
+  do {
+    Status = SdCardPollOpCondHost(Private, &Ready);
+    if (EFI_ERROR(Status)) {
+      return Status;
+    }
+    Polls++;
+    
+    if (Ready) {
+      break;
+    }
+    
+    // Wait before retrying
+    Status = SdCardOpCondBackoff(StartNs, &IntervalUs);
+  } while (!EFI_ERROR(Status));
+  
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_ERROR, "SdCardHost: ACMD41 timeout after %u polls\n", Polls));
+    return EFI_TIMEOUT;
+  }
+  
+  Private->OpCondReadyUs = SdCardOpCondElapsedUs(StartNs);
+  DEBUG((DEBUG_INFO, "SdCardHost: Card ready after %u us (%u ACMD41 polls)\n", Private->OpCondReadyUs, Polls));
+  
+  return SdCardCompleteInitHost(Private);
+}
+
 /**
   Host mode read/write function.
 **/
@@ -51,6 +51,36 @@ SdCardInitializeHost (
   IN SD_CARD_PRIVATE_DATA   *Private
   );
 
+/**
+  Resets and identifies the card with CMD0 and CMD8 in Host mode.
+**/
+EFI_STATUS
+EFIAPI
+SdCardIdentifyHost (
+  IN SD_CARD_PRIVATE_DATA   *Private
+  );
+
+/**
+  Issues one round of ACMD41 in Host mode.
+  @param[in]  Private  SD card private data
+  @param[out] Ready    TRUE once the card reports power up complete
+**/
+EFI_STATUS
+EFIAPI
+SdCardPollOpCondHost (
+  IN  SD_CARD_PRIVATE_DATA  *Private,
+  OUT BOOLEAN               *Ready
+  );
+
+/**
+  Finishes Host mode initialization after ACMD41 has completed.
+**/
+EFI_STATUS
+EFIAPI
+SdCardCompleteInitHost (
+  IN SD_CARD_PRIVATE_DATA   *Private
+  );
+
 /**
   Host mode read/write function.
   
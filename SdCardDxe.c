@@ -2,7 +2,10 @@
 #include "SdCardMedia.h"
 #include "HostIo.h"
 #include "SpiIo.h"
+#include "SpiLib.h"
 #include "SdCardMode.h"
+#include "SdCardWarmBoot.h"
+#include "DriverLib.h"
 #include <Library/BaseMemoryLib.h>
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/UefiLib.h>
@@ -171,12 +174,49 @@ SdCardDriverBindingStart(
   Private->Signature = SD_CARD_PRIVATE_DATA_SIGNATURE;
   Private->DriverBinding = This;
   Private->Handle = NULL;
+  Private->ControllerHandle = ControllerHandle;
 
   //
-  // Determine operation mode
+  // Get the parent's device path and create a complete device path for the SD card
+  //
+  Status = gBS->OpenProtocol(
+      ControllerHandle,
+      &gEfiDevicePathProtocolGuid,
+      (VOID **)&ParentDevicePath,
+      This->DriverBindingHandle,
+      ControllerHandle,
+      EFI_OPEN_PROTOCOL_GET_PROTOCOL);
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((DEBUG_ERROR, "SdCardDxe: Failed to get parent device path: %r\n", Status));
+    goto Exit;
+  }
+
+  Private->DevicePath = CreateSdCardDevicePath(ParentDevicePath);
+  if (Private->DevicePath == NULL)
+  {
+    DEBUG((DEBUG_ERROR, "SdCardDxe: Failed to create SD card device path\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Exit;
+  }
+
+  //
+  // Determine operation mode. The mode that brought up the card on this
+  // controller last boot is used again, which spares a failing attempt in
+  // the other mode before falling back.
   //
   ForceSpi = PcdGetBool(PcdSdCardSpiOnlyMode);
-  Mode = SdCardProbeMode(ControllerHandle, ForceSpi);
+  SdCardLoadWarmBoot(Private, ParentDevicePath);
+  if (!ForceSpi && Private->WarmBoot.Loaded &&
+      ValidateMode(ControllerHandle, (SD_CARD_MODE)Private->WarmBoot.Cached.Mode))
+  {
+    Mode = (SD_CARD_MODE)Private->WarmBoot.Cached.Mode;
+    DEBUG((DEBUG_INFO, "SdCardDxe: Using %a mode from the previous boot\n", GetModeName(Mode)));
+  }
+  else
+  {
+    Mode = SdCardProbeMode(ControllerHandle, ForceSpi);
+  }
 
   if (Mode == SD_CARD_MODE_UNKNOWN)
   {
@@ -234,25 +274,18 @@ SdCardDriverBindingStart(
 
     // Configure SPI peripheral with common defaults
     Private->SpiPeripheral->SpiBus = 0;
-    Private->SpiPeripheral->MaxClockHz = 25000000; // SD Card max in SPI mode
+    Private->SpiPeripheral->MaxClockHz = SPI_INIT_CLOCK_HZ; // Raised once the card is identified
 
-    DEBUG((DEBUG_INFO, "SdCardDxe: Operating in SPI mode\n"));
-  }
-
-  //
-  // Initialize the SD card
-  //
-  Status = SdCardInitialize(Private);
-  if (EFI_ERROR(Status))
-  {
-    DEBUG((DEBUG_ERROR, "SdCardDxe: Failed to initialize SD card: %r\n", Status));
-
-    // Attempt mode fallback if initialization failed
-    Status = SdCardHandleModeFallback(Private, Status);
+    // Plan transfers against the controller, then size the transfer arena
+    // once so the I/O path never allocates
+    SpiConfigureHostController(Private);
+    Status = SpiArenaInitialize(Private);
     if (EFI_ERROR(Status))
     {
       goto Exit;
     }
+
+    DEBUG((DEBUG_INFO, "SdCardDxe: Operating in SPI mode\n"));
   }
 
   //
@@ -266,14 +299,15 @@ SdCardDriverBindingStart(
   Private->BlockIo.FlushBlocks = SdCardMediaFlushBlocks;
 
   //
-  // Set up Block I/O Media information
+  // Set up Block I/O Media information. The card is brought up in the
+  // background, so there is no media until the init timer finishes.
   //
-  Private->BlockMedia.MediaPresent = TRUE;
+  Private->BlockMedia.MediaPresent = FALSE;
   Private->BlockMedia.LogicalPartition = FALSE;
   Private->BlockMedia.ReadOnly = FALSE; // Will be set based on write protect detection
   Private->BlockMedia.WriteCaching = FALSE;
-  Private->BlockMedia.BlockSize = Private->BlockSize;
-  Private->BlockMedia.LastBlock = Private->LastBlock;
+  Private->BlockMedia.BlockSize = SD_BLOCK_SIZE;
+  Private->BlockMedia.LastBlock = 0;
 
   // Set alignment based on mode
   if (Private->Mode == SD_CARD_MODE_HOST)
@@ -285,30 +319,6 @@ SdCardDriverBindingStart(
     Private->BlockMedia.IoAlign = 1; // 1-byte alignment for SPI
   }
 
-  //
-  // Get the parent's device path and create a complete device path for the SD card
-  //
-  Status = gBS->OpenProtocol(
-      ControllerHandle,
-      &gEfiDevicePathProtocolGuid,
-      (VOID **)&ParentDevicePath,
-      This->DriverBindingHandle,
-      ControllerHandle,
-      EFI_OPEN_PROTOCOL_GET_PROTOCOL);
-  if (EFI_ERROR(Status))
-  {
-    DEBUG((DEBUG_ERROR, "SdCardDxe: Failed to get parent device path: %r\n", Status));
-    goto Exit;
-  }
-
-  Private->DevicePath = CreateSdCardDevicePath(ParentDevicePath);
-  if (Private->DevicePath == NULL)
-  {
-    DEBUG((DEBUG_ERROR, "SdCardDxe: Failed to create SD card device path\n"));
-    Status = EFI_OUT_OF_RESOURCES;
-    goto Exit;
-  }
-
   //
   // Install protocols on a new child handle
   //
@@ -351,20 +361,44 @@ SdCardDriverBindingStart(
   if (EFI_ERROR(Status))
   {
     DEBUG((DEBUG_ERROR, "SdCardDxe: Failed to open protocol by child controller: %r\n", Status));
+    goto UninstallChild;
+  }
 
-    // Clean up the protocols we just installed
-    gBS->UninstallMultipleProtocolInterfaces(
-        Private->Handle,
-        &gEfiBlockIoProtocolGuid, &Private->BlockIo,
-        &gEfiDevicePathProtocolGuid, Private->DevicePath,
-        &gEfiComponentName2ProtocolGuid, &gSdCardComponentName2,
-        NULL);
-    goto Exit;
+  //
+  // Open read streams are closed when idle and before the OS takes over, and
+  // a pending write busy is checked between requests
+  //
+  Status = SdCardCreateEventsSpi(Private);
+  if (!EFI_ERROR(Status))
+  {
+    //
+    // Bring the card up from the init timer rather than holding up Start
+    //
+    Status = SdCardStartInitialize(Private);
+  }
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((DEBUG_ERROR, "SdCardDxe: Failed to start card initialization: %r\n", Status));
+    gBS->CloseProtocol(
+        ControllerHandle,
+        (Private->Mode == SD_CARD_MODE_HOST) ? &gEfiSdMmcPassThruProtocolGuid : &gEfiSpiHcProtocolGuid,
+        This->DriverBindingHandle,
+        Private->Handle);
+    goto UninstallChild;
   }
 
   DEBUG((DEBUG_INFO, "SdCardDxe: Driver started successfully. Child Handle: %p\n", Private->Handle));
   return EFI_SUCCESS;
 
+UninstallChild:
+  // Clean up the protocols we just installed
+  gBS->UninstallMultipleProtocolInterfaces(
+      Private->Handle,
+      &gEfiBlockIoProtocolGuid, &Private->BlockIo,
+      &gEfiDevicePathProtocolGuid, Private->DevicePath,
+      &gEfiComponentName2ProtocolGuid, &gSdCardComponentName2,
+      NULL);
+
 Exit:
   // Centralized cleanup logic
   if (EFI_ERROR(Status))
@@ -394,11 +428,16 @@ Exit:
         }
       }
 
+      SdCardStopInitialize(Private);
+      SdCardCloseEventsSpi(Private);
+
       if (Private->SpiPeripheral != NULL)
       {
         FreePool(Private->SpiPeripheral);
       }
 
+      SpiArenaFree(Private);
+
       if (Private->DevicePath != NULL)
       {
         FreePool(Private->DevicePath);
@@ -464,6 +503,10 @@ SdCardDriverBindingStop(
 
     Private = SD_CARD_PRIVATE_DATA_FROM_BLOCK_IO(BlockIo);
 
+    // Nothing may touch the card once its handle starts coming down
+    SdCardStopInitialize(Private);
+    SdCardCloseEventsSpi(Private);
+
     //
     // Disconnect the child controller by closing BY_CHILD_CONTROLLER
     //
@@ -533,11 +576,19 @@ SdCardDriverBindingStop(
     else
     {
       // Successfully uninstalled, free resources
+      if (Private->Mode == SD_CARD_MODE_SPI && Private->SpiPeripheral != NULL)
+      {
+        SdCardCloseStreamSpi(Private);
+        SdCardFinishWriteSpi(Private);
+      }
+
       if (Private->SpiPeripheral != NULL)
       {
         FreePool(Private->SpiPeripheral);
       }
 
+      SpiArenaFree(Private);
+
       if (Private->DevicePath != NULL)
       {
         FreePool(Private->DevicePath);
@@ -594,6 +645,9 @@ SdCardDxeEntryPoint(
 {
   EFI_STATUS Status;
 
+  // Pick the CRC16 engine before any card traffic
+  SdCardInitializeCrc16();
+
   // Initialize the driver binding handle
   gSdCardDriverBinding.ImageHandle = ImageHandle;
   gSdCardDriverBinding.DriverBindingHandle = ImageHandle;
@@ -729,19 +783,18 @@ SwitchToBootPartition(
   DEBUG((DEBUG_INFO, "SdCard: Switching to %s partition\n",
          BootPartition ? "boot" : "main"));
 
+  // Boot partitions are an eMMC feature; in SPI mode CMD6 is the SD
+  // SWITCH_FUNC command and this argument would be misread as a function switch
+  if (Private->Mode != SD_CARD_MODE_HOST)
+  {
+    DEBUG((DEBUG_WARN, "SdCard: Partition switching is not available in SPI mode\n"));
+    return EFI_UNSUPPORTED;
+  }
+
   // Send CMD6 to switch partition
   UINT32 PartitionArg = BootPartition ? 0x03B70200 : 0x03B70100;
 
-  if (Private->Mode == SD_CARD_MODE_HOST)
-  {
-    Status = SdCardSendCommandHost(Private, CMD6, PartitionArg, &Response);
-  }
-  else
-  {
-    UINT8 Resp;
-    Status = SdCardSendCommandSpi(Private, CMD6, PartitionArg, &Resp);
-    Response = Resp;
-  }
+  Status = SdCardSendCommandHost(Private, CMD6, PartitionArg, &Response);
 
   if (EFI_ERROR(Status))
   {
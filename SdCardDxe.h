@@ -31,6 +31,204 @@ typedef enum
   CARD_TYPE_MMC
 } CARD_TYPE;
 
+//
+// Receive bytes deferred by the SPI batch until the next flush.
+//
+#define SD_CARD_SPI_MAX_CAPTURES  8
+
+typedef struct
+{
+  UINT8 *Buffer; // Caller buffer to receive the bytes
+  UINTN Offset;  // Offset of the bytes within the batch
+  UINTN Length;  // Number of bytes
+  UINT16 *Crc;   // Running CRC16 to fold the bytes into, or NULL
+} SD_CARD_SPI_CAPTURE;
+
+//
+// Per-device SPI transaction arena. It is sized once when the SPI transport is
+// brought up so that the steady-state read/write path never touches the pool.
+//
+typedef struct
+{
+  UINT8 *FillBuffer;                   // Persistent 0xFF transmit region
+  UINT8 *ScratchBuffer;                // Discardable receive region
+  UINT8 *StagingBuffer;                // Transmit assembly region for merged transfers
+  UINTN Size;                          // Size of each region in bytes
+  EFI_SPI_BUS_TRANSACTION Transaction; // Reusable transaction descriptor
+  UINT64 TransactionCount;             // Transactions issued to the host controller
+  UINT64 PoolAllocations;              // Pool allocations made on the transfer path
+  UINTN BatchLength;                   // Bytes queued in the staging region
+  UINTN CaptureCount;                  // Entries used in Captures
+  SD_CARD_SPI_CAPTURE Captures[SD_CARD_SPI_MAX_CAPTURES];
+} SD_CARD_SPI_ARENA;
+
+//
+// SPI transfer planner, built at Start from the EFI_SPI_HC_PROTOCOL
+// capabilities. It decides how transfers are split, merged and framed.
+//
+typedef struct
+{
+  UINT32 MaxTransferBytes; // Largest single transaction the controller accepts
+  UINT32 FrameSizeMask;    // Supported frame sizes (bit N-1 set for N-bit frames)
+  UINT32 MaxFrameBits;     // Widest frame used for bulk payloads (8, 16 or 32)
+  BOOLEAN WriteOnly;       // Use write-only transactions for transmit-only transfers
+  BOOLEAN ReadOnly;        // Use read-only transactions (MOSI held high) for receive-only transfers
+} SD_CARD_SPI_PLANNER;
+
+//
+// Closed-loop SPI data clock state. Training picks the starting step on the
+// clock ladder; at run time CRC error bursts move one step down and a clean
+// window moves one step back up.
+//
+typedef struct
+{
+  UINT32 StepIndex;      // Current step on the clock ladder
+  UINT32 CeilingIndex;   // Highest step the card and platform allow
+  UINT32 WindowCount;    // Transfers seen in the current error window
+  UINT32 ErrorCount;     // CRC errors seen in the current error window
+  UINT32 CleanCount;     // Consecutive transfers without a CRC error
+  UINT32 UpshiftWindow;  // Clean transfers required before stepping up
+  BOOLEAN Probation;     // The last step up has not yet proven stable
+  BOOLEAN Trained;       // Training has run for the current card
+  UINT32 BestIndex;      // Highest step that has passed training so far
+  UINT8 Reference[512];  // LBA 0 as read at the lowest step during training
+} SD_CARD_SPI_CLOCK_MONITOR;
+
+//
+// Read access (NAC) prediction for the SPI data token search. The gap before
+// the start token is predicted from the CSD TAAC/NSAC fields, then tracked
+// as an average of the offsets actually observed.
+//
+typedef struct
+{
+  UINT32 ClockHz;        // Clock the byte counts below were computed for
+  UINT32 PredictedBytes; // Gap predicted from TAAC/NSAC
+  UINT32 TimeoutBytes;   // Bytes to scan before giving up on the token
+  UINT32 AverageOffset4; // Average observed token offset, times 4
+  UINT32 ReadTimeoutUs;  // Read timeout derived from the CSD, 0 if unknown
+} SD_CARD_SPI_NAC;
+
+//
+// Parser state for a streaming CMD18 read. The byte stream is parsed as
+// gap -> start token -> payload -> CRC -> gap straight into the caller's buffer.
+//
+typedef enum {
+  SdCardSpiStreamGap,     // Waiting for the start token
+  SdCardSpiStreamPayload, // Receiving block payload
+  SdCardSpiStreamCrc      // Receiving the CRC16 that ends the block
+} SD_CARD_SPI_STREAM_STATE;
+
+typedef struct
+{
+  SD_CARD_SPI_STREAM_STATE State;
+  UINT8 *Block;       // Caller buffer for the block being received
+  UINTN Offset;       // Payload bytes received for the current block
+  UINTN GapBytes;     // Bytes scanned while waiting for the current token
+  UINTN CrcIndex;     // CRC bytes received for the current block
+  UINT8 Crc[2];       // Received CRC16, big-endian
+  UINT16 BlockCrc;    // CRC16 of the payload received so far
+  UINTN BlocksDone;   // Blocks received and verified
+  BOOLEAN Open;       // CMD18 left running after the last read
+  EFI_LBA NextLba;    // LBA following the last block read
+  EFI_EVENT IdleEvent; // Closes the stream once no read has continued it
+  EFI_EVENT ExitBootServicesEvent; // Closes the stream before the OS takes the card
+} SD_CARD_SPI_STREAM;
+
+//
+// SPI write state. What the card has refused is remembered so that optional
+// commands are not retried on every write. Writes and R1b commands return
+// without waiting for busy; a timer checks it between requests and whatever
+// touches the card next waits out what is left.
+//
+typedef struct
+{
+  BOOLEAN PreEraseUnsupported; // Card rejected ACMD23 as an illegal command
+  BOOLEAN BusyPending;         // Card may be busy; cleared by a poll that sees it ready
+  EFI_EVENT BusyEvent;         // Checks a pending busy between requests
+  UINT32 BusyTimeoutUs;        // Write busy timeout derived from the CSD, 0 if unknown
+  UINT32 EraseBlocks;          // AU size in blocks; 0 if zero writes are not erased
+  UINT32 EraseTimeoutPerAuUs;  // Erase busy timeout per AU
+  UINT32 EraseOffsetUs;        // Erase busy timeout added to every erase
+} SD_CARD_SPI_WRITE;
+
+//
+// Ready-to-send SPI frames for commands that are sent over and over with the
+// same argument (CMD0, CMD8, CMD12, CMD13, CMD55). An entry is rebuilt when
+// its command is sent with a different argument, e.g. a new RCA.
+//
+#define SD_CARD_SPI_FRAME_CACHE_SIZE  5
+
+typedef struct
+{
+  BOOLEAN Valid;
+  UINT32 Argument;
+  UINT8 Frame[6]; // Command, argument, CRC7 and end bit
+} SD_CARD_SPI_FRAME;
+
+//
+// Card bring-up states. Start installs BlockIo with no media present and a
+// periodic timer moves the card through these states, one step per tick,
+// until it reaches the transfer state.
+//
+typedef enum
+{
+  SdCardInitPowerOn,     // Check that a card answers
+  SdCardInitIdentify,    // Clock the card into its mode, CMD0 and CMD8
+  SdCardInitOpCond,      // ACMD41 until the card leaves idle
+  SdCardInitRegisters,   // CID, OCR and CSD, block length
+  SdCardInitDataClock,   // Rated data clock and the High Speed switch
+  SdCardInitTrainStart,  // Training reference block, or the remembered clock
+  SdCardInitTrainStep,   // One clock ladder step per tick
+  SdCardInitEraseProbe,  // SCR and SD Status
+  SdCardInitMedia,       // Media parameters; BlockIo reports media
+  SdCardInitPersist,     // Warm boot record
+  SdCardInitReady,       // Transfer state; BlockIo consumers are told
+  SdCardInitNoCard,      // Nothing answered
+  SdCardInitFailed       // Initialization failed in every usable mode
+} SD_CARD_INIT_STATE;
+
+typedef struct
+{
+  SD_CARD_INIT_STATE State;
+  EFI_EVENT TimerEvent;  // Periodic event advancing the state machine
+  EFI_STATUS Status;     // Why the machine stopped in a failure state
+  BOOLEAN FallbackTried; // Other access mode already attempted
+  UINT64 OpCondStartNs;  // Time of the first ACMD41
+  UINT64 NextPollNs;     // Earliest time for the next ACMD41
+  UINT32 IntervalUs;     // Current ACMD41 backoff interval
+  UINT32 Polls;          // ACMD41 rounds issued
+} SD_CARD_INIT;
+
+#define SD_CARD_INIT_TIMER_PERIOD  EFI_TIMER_PERIOD_MILLISECONDS(1)
+
+//
+// What the previous boot learned about the card on a controller, stored in
+// a non-volatile variable. The CID decides whether it still applies. The CSD
+// is the one read before any High Speed switch.
+//
+#define SD_CARD_WARM_BOOT_VERSION  1
+
+typedef struct
+{
+  UINT32 Version;  // SD_CARD_WARM_BOOT_VERSION
+  UINT32 Mode;     // SD_CARD_MODE that brought the card up
+  UINT32 CardType; // CARD_TYPE after initialization
+  UINT32 ClockHz;  // Data clock in use after initialization
+  UINT8 Cid[16];
+  UINT8 Csd[16];
+  UINT8 Ocr[4];
+  UINT8 Scr[8];
+} SD_CARD_WARM_BOOT_DATA;
+
+typedef struct
+{
+  SD_CARD_WARM_BOOT_DATA Cached; // Record from the variable
+  UINT8 Csd[16];                 // CSD as first read this boot
+  CHAR16 VariableName[16];       // "SdCard" and the device path CRC32
+  BOOLEAN Loaded;                // Cached holds a record for this controller
+  BOOLEAN Hit;                   // The card matched it during this initialization
+} SD_CARD_WARM_BOOT;
+
 // Private data structure for the SD Card device instance
 #define SD_CARD_PRIVATE_DATA_SIGNATURE SIGNATURE_32('s', 'd', 'c', 'd')
 #define SD_CARD_PRIVATE_DATA_FROM_BLOCK_IO(a) \
@@ -51,6 +249,8 @@ typedef struct _SD_CARD_PRIVATE_DATA
   BOOLEAN IsHighCapacity; // TRUE for SDHC/SDXC cards
   BOOLEAN IsInitialized;  // Card initialization status
   UINT16 Rca;             // Relative Card Address
+  UINT32 OpCondReadyUs;   // Time the card took to leave idle under ACMD41
+  SD_CARD_INIT Init;      // Timer-driven bring-up state machine
 
   // Bus Configuration
   UINT32 MaxClockHz;     // Maximum supported clock frequency
@@ -62,6 +262,7 @@ typedef struct _SD_CARD_PRIVATE_DATA
   UINT8 Cid[16]; // Card Identification register
   UINT8 Ocr[4];  // Operation Conditions register
   UINT8 Scr[8];  // SD Configuration register
+  SD_CARD_WARM_BOOT WarmBoot; // Card identity remembered from the previous boot
 
   // Capacity Information
   UINT64 CapacityInBytes; // Total card capacity in bytes
@@ -90,6 +291,13 @@ typedef struct _SD_CARD_PRIVATE_DATA
   // SPI Transfer Settings
   UINT32 SpiTransferTimeout; // Transfer timeout in microseconds
   UINT32 SpiMaxRetries;      // Maximum retry attempts
+  SD_CARD_SPI_ARENA SpiArena; // Preallocated SPI transfer buffers and descriptor
+  SD_CARD_SPI_PLANNER SpiPlanner; // Transfer limits derived from the host controller
+  SD_CARD_SPI_CLOCK_MONITOR SpiClock; // Data clock training and CRC error monitor
+  SD_CARD_SPI_NAC SpiNac;     // Read access time prediction for the token search
+  SD_CARD_SPI_STREAM SpiStream; // Streaming multi-block read parser
+  SD_CARD_SPI_WRITE SpiWrite;   // Multi-block write capabilities of the card
+  SD_CARD_SPI_FRAME SpiFrames[SD_CARD_SPI_FRAME_CACHE_SIZE]; // Prebuilt command frames
 
   // Protocol Instances
   EFI_SD_MMC_PASS_THRU_PROTOCOL *SdMmcPassThru; // SD/MMC PassThru protocol
@@ -103,6 +311,7 @@ typedef struct _SD_CARD_PRIVATE_DATA
 } SD_CARD_PRIVATE_DATA;
 
 extern EFI_GUID gSdCardDevicePathGuid;
+extern EFI_GUID gSdCardWarmBootGuid;
 extern EFI_COMPONENT_NAME2_PROTOCOL gSdCardComponentName2;
 
 //
@@ -113,6 +322,16 @@ EFIAPI
 SdCardInitialize(
     IN SD_CARD_PRIVATE_DATA *Private);
 
+EFI_STATUS
+EFIAPI
+SdCardStartInitialize(
+    IN SD_CARD_PRIVATE_DATA *Private);
+
+VOID
+EFIAPI
+SdCardStopInitialize(
+    IN SD_CARD_PRIVATE_DATA *Private);
+
 EFI_STATUS
 EFIAPI
 SdCardExecuteReadWrite(
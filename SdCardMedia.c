@@ -4,8 +4,10 @@
 #include "HostIo.h"
 #include "SpiIo.h"
 #include "SdCardMode.h"
+#include "SdCardWarmBoot.h"
 #include <Library/DebugLib.h>
 #include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
 #include <Library/TimerLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/MemoryAllocationLib.h>
@@ -16,13 +18,14 @@ STATIC EFI_STATUS ParseCsdRegister(IN SD_CARD_PRIVATE_DATA *Private);
 STATIC EFI_STATUS CheckCardStatus(IN SD_CARD_PRIVATE_DATA *Private);
 STATIC BOOLEAN DetectCardPresence(IN SD_CARD_PRIVATE_DATA *Private);
 STATIC VOID UpdateMediaParameters(IN SD_CARD_PRIVATE_DATA *Private);
+STATIC EFI_STATUS FinishInitialization(IN SD_CARD_PRIVATE_DATA *Private);
 
 /**
-  Resets the block device.
+  Resets the block device. Called at TPL_CALLBACK.
 **/
+STATIC
 EFI_STATUS
-EFIAPI
-SdCardMediaReset(
+MediaResetLocked(
     IN EFI_BLOCK_IO_PROTOCOL *This,
     IN BOOLEAN ExtendedVerification)
 {
@@ -35,6 +38,12 @@ SdCardMediaReset(
     return EFI_NO_MEDIA;
   }
 
+  if (Private->Mode == SD_CARD_MODE_SPI)
+  {
+    SdCardCloseStreamSpi(Private);
+    SdCardFinishWriteSpi(Private);
+  }
+
   // For extended verification, reinitialize the card
   if (ExtendedVerification)
   {
@@ -50,11 +59,11 @@ SdCardMediaReset(
 }
 
 /**
-  Reads blocks from the SD card.
+  Reads blocks from the SD card. Called at TPL_CALLBACK.
 **/
+STATIC
 EFI_STATUS
-EFIAPI
-SdCardMediaReadBlocks(
+MediaReadBlocksLocked(
     IN EFI_BLOCK_IO_PROTOCOL *This,
     IN UINT32 MediaId,
     IN EFI_LBA Lba,
@@ -149,11 +158,11 @@ SdCardMediaReadBlocks(
 }
 
 /**
-  Writes blocks to the SD card.
+  Writes blocks to the SD card. Called at TPL_CALLBACK.
 **/
+STATIC
 EFI_STATUS
-EFIAPI
-SdCardMediaWriteBlocks(
+MediaWriteBlocksLocked(
     IN EFI_BLOCK_IO_PROTOCOL *This,
     IN UINT32 MediaId,
     IN EFI_LBA Lba,
@@ -250,11 +259,11 @@ SdCardMediaWriteBlocks(
 }
 
 /**
-  Flushes any cached data to the SD card.
+  Flushes any cached data to the SD card. Called at TPL_CALLBACK.
 **/
+STATIC
 EFI_STATUS
-EFIAPI
-SdCardMediaFlushBlocks(
+MediaFlushBlocksLocked(
     IN EFI_BLOCK_IO_PROTOCOL *This)
 {
   SD_CARD_PRIVATE_DATA *Private = SD_CARD_PRIVATE_DATA_FROM_BLOCK_IO(This);
@@ -268,10 +277,104 @@ SdCardMediaFlushBlocks(
     return EFI_NO_MEDIA;
   }
 
+  // Leave the card idle rather than in an open read stream, and wait out the
+  // programming of the last write
+  if (Private->Mode == SD_CARD_MODE_SPI)
+  {
+    SdCardCloseStreamSpi(Private);
+    EFI_STATUS Status = SdCardFinishWriteSpi(Private);
+    if (EFI_ERROR(Status))
+    {
+      DEBUG((DEBUG_ERROR, "SdCardMedia: Flush failed: %r\n", Status));
+      return Status;
+    }
+  }
+
   DEBUG((DEBUG_VERBOSE, "SdCardMedia: Flush completed\n"));
   return EFI_SUCCESS;
 }
 
+/**
+  Resets the block device.
+
+  The BlockIo entry points run at TPL_CALLBACK so that the init and stream
+  idle timers, which also drive the card, never land in the middle of a
+  request.
+**/
+EFI_STATUS
+EFIAPI
+SdCardMediaReset(
+    IN EFI_BLOCK_IO_PROTOCOL *This,
+    IN BOOLEAN ExtendedVerification)
+{
+  EFI_TPL OldTpl;
+  EFI_STATUS Status;
+
+  OldTpl = gBS->RaiseTPL(TPL_CALLBACK);
+  Status = MediaResetLocked(This, ExtendedVerification);
+  gBS->RestoreTPL(OldTpl);
+  return Status;
+}
+
+/**
+  Reads blocks from the SD card.
+**/
+EFI_STATUS
+EFIAPI
+SdCardMediaReadBlocks(
+    IN EFI_BLOCK_IO_PROTOCOL *This,
+    IN UINT32 MediaId,
+    IN EFI_LBA Lba,
+    IN UINTN BufferSize,
+    OUT VOID *Buffer)
+{
+  EFI_TPL OldTpl;
+  EFI_STATUS Status;
+
+  OldTpl = gBS->RaiseTPL(TPL_CALLBACK);
+  Status = MediaReadBlocksLocked(This, MediaId, Lba, BufferSize, Buffer);
+  gBS->RestoreTPL(OldTpl);
+  return Status;
+}
+
+/**
+  Writes blocks to the SD card.
+**/
+EFI_STATUS
+EFIAPI
+SdCardMediaWriteBlocks(
+    IN EFI_BLOCK_IO_PROTOCOL *This,
+    IN UINT32 MediaId,
+    IN EFI_LBA Lba,
+    IN UINTN BufferSize,
+    IN VOID *Buffer)
+{
+  EFI_TPL OldTpl;
+  EFI_STATUS Status;
+
+  OldTpl = gBS->RaiseTPL(TPL_CALLBACK);
+  Status = MediaWriteBlocksLocked(This, MediaId, Lba, BufferSize, Buffer);
+  gBS->RestoreTPL(OldTpl);
+  return Status;
+}
+
+/**
+  Flushes any cached data to the SD card.
+**/
+EFI_STATUS
+EFIAPI
+SdCardMediaFlushBlocks(
+    IN EFI_BLOCK_IO_PROTOCOL *This)
+{
+  EFI_TPL OldTpl;
+  EFI_STATUS Status;
+
+  OldTpl = gBS->RaiseTPL(TPL_CALLBACK);
+  Status = MediaFlushBlocksLocked(This);
+  gBS->RestoreTPL(OldTpl);
+  return Status;
+}
+
 /**
   Initializes the SD card (dispatcher function).
 **/
@@ -321,26 +424,297 @@ SdCardInitialize(
     }
   }
 
-  // Get card identification data
-  Status = GetCardIdentificationData(Private);
-  if (EFI_ERROR(Status))
+  Status = FinishInitialization(Private);
+  if (!EFI_ERROR(Status))
   {
-    DEBUG((DEBUG_ERROR, "SdCardMedia: Failed to get identification data: %r\n", Status));
+    SdCardSaveWarmBoot(Private);
+  }
+
+  return Status;
+}
+
+/**
+  Advances the bring-up state machine by one state. The ACMD41 state stays
+  put until its backoff interval has passed, so that one tick never waits on
+  the card. Card setup is spread over several ticks, with clock training
+  trying one ladder step per tick, so each tick does a bounded amount of bus
+  work at TPL_CALLBACK.
+**/
+STATIC
+VOID
+SdCardInitStep(
+    IN SD_CARD_PRIVATE_DATA *Private)
+{
+  SD_CARD_INIT *Init = &Private->Init;
+  EFI_STATUS Status;
+  BOOLEAN Ready;
+  BOOLEAN Done;
+  UINT64 NowNs;
+  UINT32 WaitUs;
+
+  switch (Init->State)
+  {
+  case SdCardInitPowerOn:
+    Private->IsInitialized = FALSE;
     Private->BlockMedia.MediaPresent = FALSE;
-    return Status;
+    if (!DetectCardPresence(Private))
+    {
+      Init->Status = EFI_NO_MEDIA;
+      Init->State = SdCardInitNoCard;
+      break;
+    }
+    Init->State = SdCardInitIdentify;
+    break;
+
+  case SdCardInitIdentify:
+    if (Private->Mode == SD_CARD_MODE_HOST)
+    {
+      Status = SdCardIdentifyHost(Private);
+    }
+    else
+    {
+      Status = SdCardIdentifySpi(Private);
+    }
+    if (EFI_ERROR(Status))
+    {
+      Init->Status = Status;
+      Init->State = SdCardInitFailed;
+      break;
+    }
+
+    Init->OpCondStartNs = GetTimeInNanoSecond(GetPerformanceCounter());
+    Init->NextPollNs = Init->OpCondStartNs;
+    Init->IntervalUs = SD_OP_COND_POLL_MIN_US;
+    Init->Polls = 0;
+    Init->State = SdCardInitOpCond;
+    break;
+
+  case SdCardInitOpCond:
+    NowNs = GetTimeInNanoSecond(GetPerformanceCounter());
+    if (NowNs < Init->NextPollNs)
+    {
+      break;
+    }
+
+    if (Private->Mode == SD_CARD_MODE_HOST)
+    {
+      Status = SdCardPollOpCondHost(Private, &Ready);
+    }
+    else
+    {
+      Status = SdCardPollOpCondSpi(Private, &Ready);
+    }
+    Init->Polls++;
+    if (EFI_ERROR(Status))
+    {
+      Init->Status = Status;
+      Init->State = SdCardInitFailed;
+      break;
+    }
+
+    if (Ready)
+    {
+      Private->OpCondReadyUs = SdCardOpCondElapsedUs(Init->OpCondStartNs);
+      DEBUG((DEBUG_INFO, "SdCardMedia: Card ready after %u us (%u ACMD41 polls)\n",
+             Private->OpCondReadyUs, Init->Polls));
+      Init->State = SdCardInitRegisters;
+      break;
+    }
+
+    Status = SdCardOpCondSchedule(Init->OpCondStartNs, &Init->IntervalUs, &WaitUs);
+    if (EFI_ERROR(Status))
+    {
+      DEBUG((DEBUG_ERROR, "SdCardMedia: ACMD41 timeout after %u polls\n", Init->Polls));
+      Init->Status = EFI_TIMEOUT;
+      Init->State = SdCardInitFailed;
+      break;
+    }
+    Init->NextPollNs = NowNs + MultU64x32(WaitUs, 1000);
+    break;
+
+  case SdCardInitRegisters:
+    if (Private->Mode == SD_CARD_MODE_HOST)
+    {
+      // Host controller setup is a short run of register commands
+      Status = SdCardCompleteInitHost(Private);
+      Init->State = SdCardInitMedia;
+    }
+    else
+    {
+      Status = SdCardReadRegistersSpi(Private);
+      Init->State = SdCardInitDataClock;
+    }
+    if (EFI_ERROR(Status))
+    {
+      Init->Status = Status;
+      Init->State = SdCardInitFailed;
+    }
+    break;
+
+  case SdCardInitDataClock:
+    SdCardStartDataClockSpi(Private);
+    Init->State = SdCardInitTrainStart;
+    break;
+
+  case SdCardInitTrainStart:
+  case SdCardInitTrainStep:
+    if (Init->State == SdCardInitTrainStart)
+    {
+      Status = SdCardStartTrainClockSpi(Private, &Done);
+    }
+    else
+    {
+      Status = SdCardTrainClockStepSpi(Private, &Done);
+    }
+    if (EFI_ERROR(Status) && Status != EFI_UNSUPPORTED)
+    {
+      DEBUG((DEBUG_WARN, "SdCardMedia: Clock training failed: %r\n", Status));
+    }
+    Init->State = (EFI_ERROR(Status) || Done) ? SdCardInitEraseProbe : SdCardInitTrainStep;
+    break;
+
+  case SdCardInitEraseProbe:
+    // Zero writes can become erases on cards that erase to zero
+    Status = SdCardProbeEraseSpi(Private);
+    if (EFI_ERROR(Status) && Status != EFI_UNSUPPORTED)
+    {
+      DEBUG((DEBUG_WARN, "SdCardMedia: Erase probe failed: %r\n", Status));
+    }
+    Init->State = SdCardInitMedia;
+    break;
+
+  case SdCardInitMedia:
+    Status = FinishInitialization(Private);
+    if (EFI_ERROR(Status))
+    {
+      Init->Status = Status;
+      Init->State = SdCardInitFailed;
+      break;
+    }
+    Init->State = SdCardInitPersist;
+    break;
+
+  case SdCardInitPersist:
+    SdCardSaveWarmBoot(Private);
+    Init->Status = EFI_SUCCESS;
+    Init->State = SdCardInitReady;
+    break;
+
+  default:
+    break;
   }
+}
 
-  // Update media parameters
-  UpdateMediaParameters(Private);
+/**
+  Init timer callback. Steps the bring-up state machine and, once it settles,
+  cancels the timer and tells BlockIo consumers about the new media.
+**/
+STATIC
+VOID
+EFIAPI
+SdCardInitTimerCallback(
+    IN EFI_EVENT Event,
+    IN VOID *Context)
+{
+  SD_CARD_PRIVATE_DATA *Private = (SD_CARD_PRIVATE_DATA *)Context;
+  SD_CARD_INIT *Init = &Private->Init;
 
-  Private->IsInitialized = TRUE;
-  Private->BlockMedia.MediaPresent = TRUE;
-  Private->BlockMedia.MediaId++;
+  SdCardInitStep(Private);
 
-  DEBUG((DEBUG_INFO, "SdCardMedia: Initialization successful. Capacity: %llu MB\n",
-         Private->CapacityInBytes / (1024 * 1024)));
+  // A remembered card that fails to come up is identified again from scratch
+  if (Init->State == SdCardInitFailed && Private->WarmBoot.Hit)
+  {
+    DEBUG((DEBUG_WARN, "SdCardMedia: Warm boot initialization failed: %r\n", Init->Status));
+    SdCardInvalidateWarmBoot(Private);
+    Init->State = SdCardInitPowerOn;
+    return;
+  }
 
-  return EFI_SUCCESS;
+  // One attempt in the other access mode before giving up
+  if (Init->State == SdCardInitFailed && !Init->FallbackTried)
+  {
+    DEBUG((DEBUG_WARN, "SdCardMedia: Initialization failed: %r\n", Init->Status));
+    Init->FallbackTried = TRUE;
+    if (!EFI_ERROR(SdCardSwitchModeFallback(Private, Init->Status)))
+    {
+      Init->State = SdCardInitPowerOn;
+      return;
+    }
+  }
+
+  switch (Init->State)
+  {
+  case SdCardInitReady:
+    gBS->SetTimer(Event, TimerCancel, 0);
+    // Reinstalling BlockIo makes the partition driver look at the media
+    gBS->ReinstallProtocolInterface(
+        Private->Handle,
+        &gEfiBlockIoProtocolGuid,
+        &Private->BlockIo,
+        &Private->BlockIo);
+    break;
+
+  case SdCardInitNoCard:
+  case SdCardInitFailed:
+    gBS->SetTimer(Event, TimerCancel, 0);
+    DEBUG((DEBUG_WARN, "SdCardMedia: Card not brought up in %a mode: %r\n",
+           GetModeName(Private->Mode), Init->Status));
+    break;
+
+  default:
+    break;
+  }
+}
+
+/**
+  Starts bringing the card up in the background. BlockIo reports no media
+  until the card reaches the transfer state; the BlockIo interface is then
+  reinstalled so that consumers connect to it.
+  @param[in] Private  SD card private data with its child handle installed
+  @return EFI_STATUS of creating and arming the init timer
+**/
+EFI_STATUS
+EFIAPI
+SdCardStartInitialize(
+    IN SD_CARD_PRIVATE_DATA *Private)
+{
+  EFI_STATUS Status;
+
+  Private->Init.State = SdCardInitPowerOn;
+  Private->Init.Status = EFI_NOT_READY;
+  Private->Init.FallbackTried = FALSE;
+
+  if (Private->Init.TimerEvent == NULL)
+  {
+    Status = gBS->CreateEvent(
+        EVT_TIMER | EVT_NOTIFY_SIGNAL,
+        TPL_CALLBACK,
+        SdCardInitTimerCallback,
+        Private,
+        &Private->Init.TimerEvent);
+    if (EFI_ERROR(Status))
+    {
+      return Status;
+    }
+  }
+
+  return gBS->SetTimer(Private->Init.TimerEvent, TimerPeriodic, SD_CARD_INIT_TIMER_PERIOD);
+}
+
+/**
+  Stops background bring-up and releases the init timer.
+  @param[in] Private  SD card private data
+**/
+VOID
+EFIAPI
+SdCardStopInitialize(
+    IN SD_CARD_PRIVATE_DATA *Private)
+{
+  if (Private->Init.TimerEvent != NULL)
+  {
+    gBS->CloseEvent(Private->Init.TimerEvent);
+    Private->Init.TimerEvent = NULL;
+  }
 }
 
 // =============================================================================
@@ -392,6 +766,39 @@ GetCardIdentificationData(
   return EFI_SUCCESS;
 }
 
+/**
+  Validates the identification data gathered by the mode-specific
+  initialization and publishes the card through BlockMedia.
+**/
+STATIC
+EFI_STATUS
+FinishInitialization(
+    IN SD_CARD_PRIVATE_DATA *Private)
+{
+  EFI_STATUS Status;
+
+  // Get card identification data
+  Status = GetCardIdentificationData(Private);
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((DEBUG_ERROR, "SdCardMedia: Failed to get identification data: %r\n", Status));
+    Private->BlockMedia.MediaPresent = FALSE;
+    return Status;
+  }
+
+  // Update media parameters
+  UpdateMediaParameters(Private);
+
+  Private->IsInitialized = TRUE;
+  Private->BlockMedia.MediaPresent = TRUE;
+  Private->BlockMedia.MediaId++;
+
+  DEBUG((DEBUG_INFO, "SdCardMedia: Initialization successful. Capacity: %llu MB\n",
+         Private->CapacityInBytes / (1024 * 1024)));
+
+  return EFI_SUCCESS;
+}
+
 /**
   Parses the CSD register to extract card parameters.
 **/
@@ -1,5 +1,8 @@
 #include "SdCardBlockIo.h"
 #include "SdCardDxe.h"
+#include "SdCardMode.h"
+#include "SpiIo.h"
+#include "SpiLib.h"
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/DebugLib.h>
 #include <Library/PcdLib.h>
@@ -70,14 +73,51 @@ SdCardProbeMode(
 }
 
 /**
-  Handles mode fallback when initial mode initialization fails
+  Moves a child SD card handle's BY_CHILD_CONTROLLER link from the protocol
+  of the abandoned mode to the protocol of the new one, so that Stop finds
+  the link it expects.
+  @param[in] Private  SD card private data, already switched to the new mode
+  @param[in] OldGuid  Protocol of the abandoned mode
+  @param[in] NewGuid  Protocol of the new mode
+**/
+STATIC
+VOID
+SdCardRelinkChild(
+    IN SD_CARD_PRIVATE_DATA *Private,
+    IN EFI_GUID *OldGuid,
+    IN EFI_GUID *NewGuid)
+{
+  VOID *Interface;
+
+  if (Private->Handle == NULL)
+  {
+    return;
+  }
+
+  gBS->CloseProtocol(
+      Private->ControllerHandle,
+      OldGuid,
+      gSdCardDriverBinding.DriverBindingHandle,
+      Private->Handle);
+  gBS->OpenProtocol(
+      Private->ControllerHandle,
+      NewGuid,
+      &Interface,
+      gSdCardDriverBinding.DriverBindingHandle,
+      Private->Handle,
+      EFI_OPEN_PROTOCOL_BY_CHILD_CONTROLLER);
+}
+
+/**
+  Switches the controller to the other access mode after initialization
+  failed in the current one. The card itself is not initialized.
   @param[in] Private               SD card private data
   @param[in] InitializationStatus  Status from the initial mode initialization attempt
-  @return EFI_STATUS indicating whether fallback was successful
+  @return EFI_SUCCESS if the mode was switched, otherwise why it was not
 **/
 EFI_STATUS
 EFIAPI
-SdCardHandleModeFallback(
+SdCardSwitchModeFallback(
     IN SD_CARD_PRIVATE_DATA *Private,
     IN EFI_STATUS InitializationStatus)
 {
@@ -143,25 +183,31 @@ SdCardHandleModeFallback(
 
     // Configure SPI peripheral with common defaults
     Private->SpiPeripheral->SpiBus = 0;
-    Private->SpiPeripheral->MaxClockHz = 25000000; // SD Card max in SPI mode
+    Private->SpiPeripheral->MaxClockHz = SPI_INIT_CLOCK_HZ; // Raised once the card is identified
+
+    SpiConfigureHostController(Private);
+    Status = SpiArenaInitialize(Private);
+    if (EFI_ERROR(Status))
+    {
+      DEBUG((DEBUG_ERROR, "SdCardMode: SPI fallback failed - arena allocation error\n"));
+      FreePool(Private->SpiPeripheral);
+      Private->SpiPeripheral = NULL;
+      gBS->CloseProtocol(
+          Private->ControllerHandle,
+          &gEfiSpiHcProtocolGuid,
+          gSdCardDriverBinding.DriverBindingHandle,
+          Private->ControllerHandle);
+      return Status;
+    }
+
 
     // Switch mode to SPI
     Private->Mode = SD_CARD_MODE_SPI;
 
-    DEBUG((DEBUG_INFO, "SdCardMode: Successfully switched to SPI mode for fallback\n"));
+    SdCardRelinkChild(Private, &gEfiSdMmcPassThruProtocolGuid, &gEfiSpiHcProtocolGuid);
 
-    // Retry initialization in SPI mode
-    Status = SdCardInitialize(Private);
-    if (!EFI_ERROR(Status))
-    {
-      DEBUG((DEBUG_INFO, "SdCardMode: Fallback to SPI mode successful\n"));
-      return EFI_SUCCESS;
-    }
-    else
-    {
-      DEBUG((DEBUG_ERROR, "SdCardMode: Fallback to SPI mode failed: %r\n", Status));
-      return Status;
-    }
+    DEBUG((DEBUG_INFO, "SdCardMode: Successfully switched to SPI mode for fallback\n"));
+    return EFI_SUCCESS;
   }
 
   // Check if we're in SPI mode and MMC host is available (less common fallback)
@@ -200,6 +246,8 @@ SdCardHandleModeFallback(
       Private->SpiPeripheral = NULL;
     }
 
+    SpiArenaFree(Private);
+
     // Try to open MMC host protocol
     Status = gBS->OpenProtocol(
         Private->ControllerHandle,
@@ -217,26 +265,50 @@ SdCardHandleModeFallback(
     // Switch mode to host
     Private->Mode = SD_CARD_MODE_HOST;
 
-    DEBUG((DEBUG_INFO, "SdCardMode: Successfully switched to host mode for fallback\n"));
+    SdCardRelinkChild(Private, &gEfiSpiHcProtocolGuid, &gEfiSdMmcPassThruProtocolGuid);
 
-    // Retry initialization in host mode
-    Status = SdCardInitialize(Private);
-    if (!EFI_ERROR(Status))
-    {
-      DEBUG((DEBUG_INFO, "SdCardMode: Fallback to host mode successful\n"));
-      return EFI_SUCCESS;
-    }
-    else
-    {
-      DEBUG((DEBUG_ERROR, "SdCardMode: Fallback to host mode failed: %r\n", Status));
-      return Status;
-    }
+    DEBUG((DEBUG_INFO, "SdCardMode: Successfully switched to host mode for fallback\n"));
+    return EFI_SUCCESS;
   }
 
   DEBUG((DEBUG_VERBOSE, "SdCardMode: No fallback options available for current mode\n"));
   return InitializationStatus;
 }
 
+/**
+  Handles mode fallback when initial mode initialization fails
+  @param[in] Private               SD card private data
+  @param[in] InitializationStatus  Status from the initial mode initialization attempt
+  @return EFI_STATUS indicating whether fallback was successful
+**/
+EFI_STATUS
+EFIAPI
+SdCardHandleModeFallback(
+    IN SD_CARD_PRIVATE_DATA *Private,
+    IN EFI_STATUS InitializationStatus)
+{
+  EFI_STATUS Status;
+
+  Status = SdCardSwitchModeFallback(Private, InitializationStatus);
+  if (EFI_ERROR(Status))
+  {
+    return Status;
+  }
+
+  // Retry initialization in the new mode
+  Status = SdCardInitialize(Private);
+  if (!EFI_ERROR(Status))
+  {
+    DEBUG((DEBUG_INFO, "SdCardMode: Fallback to %a mode successful\n", GetModeName(Private->Mode)));
+  }
+  else
+  {
+    DEBUG((DEBUG_ERROR, "SdCardMode: Fallback to %a mode failed: %r\n", GetModeName(Private->Mode), Status));
+  }
+
+  return Status;
+}
+
 /**
   Validates that the selected mode is properly configured and available
   @param[in] ControllerHandle  Handle to the controller
@@ -5,6 +5,7 @@
 
 // Mode detection and fallback functions
 SD_CARD_MODE EFIAPI SdCardProbeMode(IN EFI_HANDLE ControllerHandle, IN BOOLEAN ForceSpi);
+EFI_STATUS EFIAPI SdCardSwitchModeFallback(IN SD_CARD_PRIVATE_DATA *Private, IN EFI_STATUS InitializationStatus);
 EFI_STATUS EFIAPI SdCardHandleModeFallback(IN SD_CARD_PRIVATE_DATA *Private, IN EFI_STATUS InitializationStatus);
 BOOLEAN EFIAPI ValidateMode(IN EFI_HANDLE ControllerHandle, IN SD_CARD_MODE Mode);
 CONST CHAR8* EFIAPI GetModeName(IN SD_CARD_MODE Mode);
@@ -0,0 +1,146 @@
+#include "SdCardBlockIo.h"
+#include "SdCardDxe.h"
+#include "SdCardWarmBoot.h"
+#include "SdCardMode.h"
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/DevicePathLib.h>
+#include <Library/PrintLib.h>
+#include <Library/UefiRuntimeServicesTableLib.h>
+
+/**
+  Loads what the previous boot learned about the card on this controller.
+  The variable is named after a CRC32 of the controller device path, so each
+  slot keeps its own record.
+  @param[in] Private         SD card private data
+  @param[in] ControllerPath  Device path of the controller
+  @retval EFI_SUCCESS    A record for this controller was loaded
+  @retval EFI_NOT_FOUND  No usable record; the card is identified in full
+**/
+EFI_STATUS
+EFIAPI
+SdCardLoadWarmBoot(
+    IN SD_CARD_PRIVATE_DATA *Private,
+    IN EFI_DEVICE_PATH_PROTOCOL *ControllerPath)
+{
+  SD_CARD_WARM_BOOT *WarmBoot = &Private->WarmBoot;
+  EFI_STATUS Status;
+  UINTN Size;
+
+  WarmBoot->Loaded = FALSE;
+  WarmBoot->Hit = FALSE;
+
+  UnicodeSPrint(WarmBoot->VariableName, sizeof(WarmBoot->VariableName), L"SdCard%08X",
+                CalculateCrc32(ControllerPath, GetDevicePathSize(ControllerPath)));
+
+  Size = sizeof(WarmBoot->Cached);
+  Status = gRT->GetVariable(WarmBoot->VariableName, &gSdCardWarmBootGuid, NULL, &Size, &WarmBoot->Cached);
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((DEBUG_VERBOSE, "SdCardWarmBoot: No record %s: %r\n", WarmBoot->VariableName, Status));
+    return EFI_NOT_FOUND;
+  }
+
+  if (Size != sizeof(WarmBoot->Cached) || WarmBoot->Cached.Version != SD_CARD_WARM_BOOT_VERSION)
+  {
+    DEBUG((DEBUG_INFO, "SdCardWarmBoot: Ignoring stale record %s\n", WarmBoot->VariableName));
+    return EFI_NOT_FOUND;
+  }
+
+  WarmBoot->Loaded = TRUE;
+  DEBUG((DEBUG_INFO, "SdCardWarmBoot: Loaded %s, %a mode at %u Hz\n", WarmBoot->VariableName,
+         GetModeName((SD_CARD_MODE)WarmBoot->Cached.Mode), WarmBoot->Cached.ClockHz));
+  return EFI_SUCCESS;
+}
+
+/**
+  Compares the CID just read from the card with the remembered one. On a
+  match the rest of initialization may take registers and the data clock
+  from the record instead of asking the card again.
+  @param[in] Private  SD card private data with Private->Cid read
+  @return TRUE if the same card is in the same mode as last boot
+**/
+BOOLEAN
+EFIAPI
+SdCardMatchWarmBoot(
+    IN SD_CARD_PRIVATE_DATA *Private)
+{
+  SD_CARD_WARM_BOOT *WarmBoot = &Private->WarmBoot;
+
+  WarmBoot->Hit = (BOOLEAN)(WarmBoot->Loaded &&
+                            WarmBoot->Cached.Mode == (UINT32)Private->Mode &&
+                            CompareMem(WarmBoot->Cached.Cid, Private->Cid, sizeof(Private->Cid)) == 0);
+  if (WarmBoot->Loaded)
+  {
+    DEBUG((DEBUG_INFO, "SdCardWarmBoot: Card %a the remembered one\n", WarmBoot->Hit ? "matches" : "differs from"));
+  }
+
+  return WarmBoot->Hit;
+}
+
+/**
+  Records the card identity and negotiated parameters after a successful
+  initialization. The variable is only written when something changed, so
+  an unchanged card costs no flash writes.
+  @param[in] Private  Initialized SD card private data
+**/
+VOID
+EFIAPI
+SdCardSaveWarmBoot(
+    IN SD_CARD_PRIVATE_DATA *Private)
+{
+  SD_CARD_WARM_BOOT *WarmBoot = &Private->WarmBoot;
+  SD_CARD_WARM_BOOT_DATA Data;
+  EFI_STATUS Status;
+
+  if (WarmBoot->VariableName[0] == L'\0')
+  {
+    return;
+  }
+
+  ZeroMem(&Data, sizeof(Data));
+  Data.Version = SD_CARD_WARM_BOOT_VERSION;
+  Data.Mode = (UINT32)Private->Mode;
+  Data.CardType = (UINT32)Private->CardType;
+  Data.ClockHz = Private->CurrentClockHz;
+  CopyMem(Data.Cid, Private->Cid, sizeof(Data.Cid));
+  CopyMem(Data.Csd, WarmBoot->Csd, sizeof(Data.Csd));
+  CopyMem(Data.Ocr, Private->Ocr, sizeof(Data.Ocr));
+  CopyMem(Data.Scr, Private->Scr, sizeof(Data.Scr));
+
+  if (WarmBoot->Loaded && CompareMem(&Data, &WarmBoot->Cached, sizeof(Data)) == 0)
+  {
+    return;
+  }
+
+  Status = gRT->SetVariable(
+      WarmBoot->VariableName,
+      &gSdCardWarmBootGuid,
+      EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS,
+      sizeof(Data),
+      &Data);
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((DEBUG_WARN, "SdCardWarmBoot: Failed to save %s: %r\n", WarmBoot->VariableName, Status));
+    return;
+  }
+
+  CopyMem(&WarmBoot->Cached, &Data, sizeof(Data));
+  WarmBoot->Loaded = TRUE;
+  DEBUG((DEBUG_INFO, "SdCardWarmBoot: Saved %s\n", WarmBoot->VariableName));
+}
+
+/**
+  Forgets the remembered card for the rest of this boot, so that the next
+  initialization reads every register from the card.
+  @param[in] Private  SD card private data
+**/
+VOID
+EFIAPI
+SdCardInvalidateWarmBoot(
+    IN SD_CARD_PRIVATE_DATA *Private)
+{
+  Private->WarmBoot.Loaded = FALSE;
+  Private->WarmBoot.Hit = FALSE;
+}
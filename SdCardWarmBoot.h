@@ -0,0 +1,12 @@
+#ifndef __SD_CARD_WARM_BOOT_H__
+#define __SD_CARD_WARM_BOOT_H__
+
+#include "SdCardDxe.h"
+
+// Warm boot cache of the card identity, one variable per controller
+EFI_STATUS EFIAPI SdCardLoadWarmBoot(IN SD_CARD_PRIVATE_DATA *Private, IN EFI_DEVICE_PATH_PROTOCOL *ControllerPath);
+BOOLEAN EFIAPI SdCardMatchWarmBoot(IN SD_CARD_PRIVATE_DATA *Private);
+VOID EFIAPI SdCardSaveWarmBoot(IN SD_CARD_PRIVATE_DATA *Private);
+VOID EFIAPI SdCardInvalidateWarmBoot(IN SD_CARD_PRIVATE_DATA *Private);
+
+#endif // __SD_CARD_WARM_BOOT_H__
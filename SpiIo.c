@@ -2,222 +2,1878 @@
 #include "SpiIo.h"
 #include "DriverLib.h"
 #include "SpiLib.h"
+#include "SdCardWarmBoot.h"
 #include <Library/DebugLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/BaseLib.h> // For SwapBytes32 and CRC16
+#include <Library/PcdLib.h>
+#include <Library/TimerLib.h>
+#include <Guid/EventGroup.h>
 
 //
 // Forward declarations for internal SPI functions
 //
 EFI_STATUS EFIAPI SdCardSendCommandSpi (IN SD_CARD_PRIVATE_DATA *Private, IN UINT8 Command, IN UINT32 Argument, OUT UINT8 *Response);
+EFI_STATUS EFIAPI SdCardSendCommandExSpi (IN SD_CARD_PRIVATE_DATA *Private, IN UINT8 Command, IN UINT32 Argument, OUT UINT8 *Response, OUT UINT8 *Trailing OPTIONAL);
 EFI_STATUS EFIAPI SdCardWaitNotBusySpi (IN SD_CARD_PRIVATE_DATA *Private);
 EFI_STATUS EFIAPI SdCardReadDataBlockSpi (IN SD_CARD_PRIVATE_DATA *Private, IN UINTN Length, OUT UINT8 *Buffer);
 EFI_STATUS EFIAPI SdCardWriteDataBlockSpi (IN SD_CARD_PRIVATE_DATA *Private, IN UINT8 Token, IN UINTN Length, IN CONST UINT8 *Buffer);
+STATIC EFI_STATUS SdCardSendDataBlockSpi (IN SD_CARD_PRIVATE_DATA *Private, IN UINT8 Token, IN UINTN Length, IN CONST UINT8 *Buffer, IN CONST UINT16 *Crc OPTIONAL);
+STATIC VOID SdCardUpdateNacSpi (IN SD_CARD_PRIVATE_DATA *Private);
+STATIC EFI_STATUS SdCardReadCidSpi (IN SD_CARD_PRIVATE_DATA *Private, OUT UINT8 *Cid);
+STATIC EFI_STATUS SdCardRestoreClockSpi (IN SD_CARD_PRIVATE_DATA *Private, IN UINT32 ClockHz);
+STATIC VOID SdCardBuildFrameSpi (IN SD_CARD_PRIVATE_DATA *Private, IN UINT8 Command, IN UINT32 Argument, OUT UINT8 *Frame);
+STATIC EFI_STATUS SdCardPollSpi (IN SD_CARD_PRIVATE_DATA *Private, IN BOOLEAN WaitForToken, IN UINT32 TimeoutUs, IN UINTN Burst, IN UINTN MaxBurst, OUT UINT8 *Buffer, OUT UINTN *Received, OUT UINTN *Scanned OPTIONAL);
 
 // =============================================================================
 // SPI I/O Functions
 // =============================================================================
+//
+// SPI data clock ladder, slowest first
+//
+STATIC CONST UINT32 mSdCardSpiClockLadder[] = {
+  5000000, 10000000, 12500000, 16666666, 20000000, 25000000, 33333333, 40000000, 50000000
+};
+
 /**
-  SPI mode read/write function.
+  Stops an open CMD18 stream with CMD12 and waits out its R1b busy.
 **/
 EFI_STATUS
 EFIAPI
-SdCardExecuteReadWriteSpi (
+SdCardCloseStreamSpi (
+  IN SD_CARD_PRIVATE_DATA  *Private
+  )
+{
+  EFI_STATUS Status;
+  UINT8      Response;
+
+  if (!Private->SpiStream.Open) {
+    return EFI_SUCCESS;
+  }
+
+  Private->SpiStream.Open = FALSE;
+  if (Private->SpiStream.IdleEvent != NULL) {
+    gBS->SetTimer(Private->SpiStream.IdleEvent, TimerCancel, 0);
+  }
+  Status = SdCardSendCommandSpi(Private, CMD12, 0, &Response);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_WARN, "SdCardSpi: CMD12 failed closing read stream: %r\n", Status));
+    return Status;
+  }
+
+  return SdCardWaitNotBusySpi(Private);
+}
+
+/**
+  Waits out the busy left behind by the last write or R1b command.
+
+  Writes return as soon as the card accepts the data, so a programming
+  failure or timeout surfaces here, on whatever touches the card next.
+**/
+EFI_STATUS
+EFIAPI
+SdCardFinishWriteSpi (
+  IN SD_CARD_PRIVATE_DATA  *Private
+  )
+{
+  EFI_STATUS Status;
+
+  if (!Private->SpiWrite.BusyPending) {
+    return EFI_SUCCESS;
+  }
+
+  Status = SdCardWaitNotBusySpi(Private);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_ERROR, "SdCardSpi: Card still busy after write or R1b command\n"));
+  }
+
+  return Status;
+}
+
+/**
+  Reads one block with CMD17 fused into a single transaction.
+
+  The transaction carries the command frame and enough clocks to capture R1,
+  the predicted token gap, the payload and the CRC. If the token has not
+  arrived within the window the search continues with the windowed polling
+  reader.
+**/
+STATIC
+EFI_STATUS
+SdCardReadSingleFusedSpi (
   IN  SD_CARD_PRIVATE_DATA  *Private,
   IN  EFI_LBA               Lba,
-  IN  UINTN                 BufferSize,
-  IN OUT  VOID                  *Buffer,
-  IN  BOOLEAN               IsWrite
+  OUT UINT8                 *Buffer
+  )
+{
+  SD_CARD_SPI_NAC *Nac = &Private->SpiNac;
+  UINT8 Frame[6];
+  UINT8 Reply[SD_CARD_SPI_FUSED_REPLY_MAX];
+  UINT8 CrcBytes[2];
+  UINTN ReplyLength;
+  UINTN Index;
+  UINTN Start;
+  UINTN Tail;
+  UINTN Copied;
+  UINT32 Average;
+  UINT32 Address;
+  UINT16 ReceivedCrc;
+  UINT16 CalculatedCrc;
+  EFI_STATUS Status;
+
+  // The frame goes out without a busy check; a write in progress is waited
+  // out first
+  Status = SdCardFinishWriteSpi(Private);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  SdCardUpdateNacSpi(Private);
+
+  Address = (Private->CardType == CARD_TYPE_SD_V2_HC) ? (UINT32)Lba : (UINT32)(Lba * SD_BLOCK_SIZE);
+  SdCardBuildFrameSpi(Private, CMD17, Address, Frame);
+
+  Average = Nac->AverageOffset4 / 4;
+  ReplyLength = SD_CARD_SPI_NCR_MAX + Average + Average / 2 + SD_CARD_SPI_TOKEN_WINDOW_MARGIN + 1 + SD_BLOCK_SIZE + 2;
+  ReplyLength = MIN(ReplyLength, sizeof(Reply));
+
+  // Reply is only parsed if every part was queued
+  Status = SpiBatchQueue(Private, Frame, NULL, sizeof(Frame));
+  if (!EFI_ERROR(Status)) {
+    Status = SpiBatchQueue(Private, NULL, Reply, ReplyLength);
+  }
+  if (EFI_ERROR(Status)) {
+    SpiBatchDiscard(Private);
+    return Status;
+  }
+  Status = SpiBatchFlush(Private);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  // R1
+  for (Index = 0; Index < SD_CARD_SPI_NCR_MAX && (Reply[Index] & 0x80) != 0; Index++) {
+  }
+  if (Index == SD_CARD_SPI_NCR_MAX) {
+    DEBUG((DEBUG_ERROR, "SdCardSpi: Timeout waiting for response to CMD17\n"));
+    return EFI_TIMEOUT;
+  }
+  if ((Reply[Index] & R1_COM_CRC_ERROR) != 0) {
+    DEBUG((DEBUG_WARN, "SdCardSpi: CRC indicated in response for CMD17\n"));
+    return EFI_CRC_ERROR;
+  }
+  if (Reply[Index] != 0) {
+    DEBUG((DEBUG_ERROR, "SdCardSpi: CMD17 rejected. Response: 0x%x\n", Reply[Index]));
+    return EFI_DEVICE_ERROR;
+  }
+
+  // Data token
+  Start = ++Index;
+  while (Index < ReplyLength && Reply[Index] == 0xFF) {
+    Index++;
+  }
+  if (Index == ReplyLength) {
+    // Slower than predicted; keep polling for the token
+    Nac->AverageOffset4 += (UINT32)(Index - Start) - Nac->AverageOffset4 / 4;
+    return SdCardReadDataBlockSpi(Private, SD_BLOCK_SIZE, Buffer);
+  }
+  if (Reply[Index] != DATA_TOKEN_READ_START) {
+    DEBUG((DEBUG_ERROR, "SdCardSpi: %a token 0x%02X for CMD17\n",
+           ((Reply[Index] & DATA_ERROR_TOKEN_MASK) == 0) ? "Data error" : "Unexpected", Reply[Index]));
+    return EFI_DEVICE_ERROR;
+  }
+  Nac->AverageOffset4 += (UINT32)(Index - Start) - Nac->AverageOffset4 / 4;
+
+  // Payload and CRC, fetching whatever did not fit in the window. The
+  // payload CRC is computed as the bytes are copied out.
+  Tail   = ReplyLength - Index - 1;
+  Copied = MIN(Tail, SD_BLOCK_SIZE);
+  CalculatedCrc = SdCardCopyCrc16(0, Buffer, &Reply[Index + 1], Copied);
+  Tail   = MIN(Tail - Copied, sizeof(CrcBytes));
+  CopyMem(CrcBytes, &Reply[Index + 1 + Copied], Tail);
+  Status = EFI_SUCCESS;
+  if (Copied < SD_BLOCK_SIZE) {
+    Status = SpiBatchQueueCrc16(Private, NULL, Buffer + Copied, SD_BLOCK_SIZE - Copied, &CalculatedCrc);
+  }
+  if (!EFI_ERROR(Status) && Tail < sizeof(CrcBytes)) {
+    Status = SpiBatchQueue(Private, NULL, CrcBytes + Tail, sizeof(CrcBytes) - Tail);
+  }
+  if (EFI_ERROR(Status)) {
+    SpiBatchDiscard(Private);
+    return Status;
+  }
+  Status = SpiBatchFlush(Private);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  ReceivedCrc = (UINT16)((CrcBytes[0] << 8) | CrcBytes[1]);
+  if (ReceivedCrc != CalculatedCrc) {
+    DEBUG((DEBUG_ERROR, "SdCardSpi: CRC mismatch on fused CMD17 LBA %lu\n", Lba));
+    return EFI_CRC_ERROR;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Opens a CMD18 stream at an LBA.
+**/
+STATIC
+EFI_STATUS
+SdCardOpenStreamSpi (
+  IN SD_CARD_PRIVATE_DATA  *Private,
+  IN EFI_LBA               Lba
+  )
+{
+  EFI_STATUS Status;
+  UINT8      Response;
+  UINT32     Address;
+
+  Address = (Private->CardType == CARD_TYPE_SD_V2_HC) ? (UINT32)Lba : (UINT32)(Lba * SD_BLOCK_SIZE);
+  Status = SdCardSendCommandSpi(Private, CMD18, Address, &Response);
+  if (EFI_ERROR(Status) || (Response & 0x80) != 0) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  Private->SpiStream.Open = TRUE;
+  return EFI_SUCCESS;
+}
+
+/**
+  Reads blocks in SPI mode, resuming from the first unverified block on error.
+
+  Reads that start where the previous read ended run as CMD18 and leave the
+  stream open, so the next sequential read continues it without a command.
+  The stream is closed by any other command, at the end of the card, by its
+  idle timer SD_CARD_SPI_STREAM_IDLE_US after the last read finished, and at
+  ExitBootServices.
+
+  When a block fails, the blocks before it have already been verified in
+  place. The stream is stopped with CMD12, and after the backoff from the read
+  retry policy CMD18 is re-issued at the failing LBA, so only the rest of the
+  request is read again. Every failure is reported to the clock monitor.
+**/
+STATIC
+EFI_STATUS
+SdCardReadBlocksSpi (
+  IN  SD_CARD_PRIVATE_DATA  *Private,
+  IN  EFI_LBA               Lba,
+  IN  UINTN                 BlockCount,
+  OUT UINT8                 *Buffer
+  )
+{
+  STATIC CONST UINT32 BackoffMs[SD_CARD_SPI_READ_MAX_RETRIES] = SD_CARD_SPI_READ_BACKOFF_MS;
+  SD_CARD_SPI_STREAM *Stream = &Private->SpiStream;
+  EFI_STATUS Status;
+  UINTN Done;
+  UINTN Attempt;
+  BOOLEAN Sequential;
+
+  Sequential = (BOOLEAN)(Lba == Stream->NextLba);
+  Done = 0;
+
+  if (Stream->Open && !Sequential) {
+    SdCardCloseStreamSpi(Private);
+  }
+
+  if (Stream->Open) {
+    Status = SdCardStreamReadSpi(Private, BlockCount, Buffer);
+    Done = Stream->BlocksDone;
+  } else if (BlockCount > 1 || Sequential) {
+    Status = SdCardOpenStreamSpi(Private, Lba);
+    if (!EFI_ERROR(Status)) {
+      Status = SdCardStreamReadSpi(Private, BlockCount, Buffer);
+      Done = Stream->BlocksDone;
+    }
+  } else {
+    // Isolated single block
+    Status = SdCardReadSingleFusedSpi(Private, Lba, Buffer);
+  }
+
+  for (Attempt = 0; EFI_ERROR(Status) && Status != EFI_NO_MEDIA; Attempt++) {
+    SdCardCloseStreamSpi(Private);
+    SdCardMonitorClockSpi(Private, Status);
+    if (Attempt >= SD_CARD_SPI_READ_MAX_RETRIES) {
+      break;
+    }
+
+    DEBUG((DEBUG_WARN, "SdCardSpi: Read failed at LBA %lu (%r), resuming after %u ms at %u Hz\n",
+           Lba + Done, Status, BackoffMs[Attempt], Private->CurrentClockHz));
+    if (BackoffMs[Attempt] != 0) {
+      gBS->Stall(BackoffMs[Attempt] * 1000);
+    }
+
+    Status = SdCardOpenStreamSpi(Private, Lba + Done);
+    if (!EFI_ERROR(Status)) {
+      Status = SdCardStreamReadSpi(Private, BlockCount - Done, Buffer + Done * SD_BLOCK_SIZE);
+      Done += Stream->BlocksDone;
+    }
+  }
+
+  if (EFI_ERROR(Status)) {
+    SdCardCloseStreamSpi(Private);
+    Stream->NextLba = MAX_UINT64;
+    return Status;
+  }
+
+  SdCardMonitorClockSpi(Private, EFI_SUCCESS);
+  Stream->NextLba = Lba + BlockCount;
+
+  // The block after the end of the card would be out of range
+  if (Stream->NextLba > Private->LastBlock) {
+    Status = SdCardCloseStreamSpi(Private);
+  } else if (Stream->Open && Stream->IdleEvent != NULL) {
+    // The idle period starts now that the transfer is done
+    gBS->SetTimer(Stream->IdleEvent, TimerRelative, EFI_TIMER_PERIOD_MICROSECONDS(SD_CARD_SPI_STREAM_IDLE_US));
+  }
+
+  return Status;
+}
+
+/**
+  Closes a CMD18 stream that no read has continued within
+  SD_CARD_SPI_STREAM_IDLE_US. Runs at TPL_CALLBACK, the level the BlockIo
+  entry points raise to, so it never lands in the middle of a request.
+**/
+STATIC
+VOID
+EFIAPI
+SdCardStreamIdleNotify (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  SD_CARD_PRIVATE_DATA *Private = (SD_CARD_PRIVATE_DATA *)Context;
+
+  if (Private->Mode == SD_CARD_MODE_SPI && Private->SpiStream.Open) {
+    DEBUG((DEBUG_VERBOSE, "SdCardSpi: Closing idle read stream at LBA %lu\n", Private->SpiStream.NextLba));
+    SdCardCloseStreamSpi(Private);
+  }
+}
+
+/**
+  Leaves the card idle for whoever takes it over after ExitBootServices: an
+  open CMD18 stream is stopped and the busy of the last write waited out.
+**/
+STATIC
+VOID
+EFIAPI
+SdCardStreamExitBootServicesNotify (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  SD_CARD_PRIVATE_DATA *Private = (SD_CARD_PRIVATE_DATA *)Context;
+
+  if (Private->SpiWrite.BusyEvent != NULL) {
+    gBS->SetTimer(Private->SpiWrite.BusyEvent, TimerCancel, 0);
+  }
+  if (Private->Mode == SD_CARD_MODE_SPI && Private->IsInitialized) {
+    SdCardCloseStreamSpi(Private);
+    SdCardFinishWriteSpi(Private);
+  }
+}
+
+/**
+  Checks a pending write busy with one byte per tick, so that the card
+  programs between requests and the next request seldom has to wait. Runs at
+  TPL_CALLBACK, the level the BlockIo entry points raise to.
+**/
+STATIC
+VOID
+EFIAPI
+SdCardBusyCheckNotify (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  SD_CARD_PRIVATE_DATA *Private = (SD_CARD_PRIVATE_DATA *)Context;
+  UINT8                Byte;
+  UINTN                Received;
+
+  if (Private->Mode == SD_CARD_MODE_SPI && Private->SpiWrite.BusyPending && !Private->SpiStream.Open) {
+    SdCardPollSpi(Private, FALSE, 0, 1, 1, &Byte, &Received, NULL);
+  }
+  if (Private->Mode != SD_CARD_MODE_SPI || !Private->SpiWrite.BusyPending || Private->SpiStream.Open) {
+    gBS->SetTimer(Event, TimerCancel, 0);
+  }
+}
+
+/**
+  Creates the idle timer and ExitBootServices event that close an open
+  CMD18 stream, and the timer that checks a pending write busy.
+**/
+EFI_STATUS
+EFIAPI
+SdCardCreateEventsSpi (
+  IN SD_CARD_PRIVATE_DATA  *Private
+  )
+{
+  EFI_STATUS Status;
+
+  Status = gBS->CreateEvent(
+                  EVT_TIMER | EVT_NOTIFY_SIGNAL,
+                  TPL_CALLBACK,
+                  SdCardStreamIdleNotify,
+                  Private,
+                  &Private->SpiStream.IdleEvent
+                  );
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  Status = gBS->CreateEventEx(
+                  EVT_NOTIFY_SIGNAL,
+                  TPL_CALLBACK,
+                  SdCardStreamExitBootServicesNotify,
+                  Private,
+                  &gEfiEventExitBootServicesGuid,
+                  &Private->SpiStream.ExitBootServicesEvent
+                  );
+  if (!EFI_ERROR(Status)) {
+    Status = gBS->CreateEvent(
+                    EVT_TIMER | EVT_NOTIFY_SIGNAL,
+                    TPL_CALLBACK,
+                    SdCardBusyCheckNotify,
+                    Private,
+                    &Private->SpiWrite.BusyEvent
+                    );
+  }
+  if (EFI_ERROR(Status)) {
+    SdCardCloseEventsSpi(Private);
+  }
+
+  return Status;
+}
+
+/**
+  Closes the events created by SdCardCreateEventsSpi.
+**/
+VOID
+EFIAPI
+SdCardCloseEventsSpi (
+  IN SD_CARD_PRIVATE_DATA  *Private
+  )
+{
+  if (Private->SpiStream.IdleEvent != NULL) {
+    gBS->CloseEvent(Private->SpiStream.IdleEvent);
+    Private->SpiStream.IdleEvent = NULL;
+  }
+  if (Private->SpiStream.ExitBootServicesEvent != NULL) {
+    gBS->CloseEvent(Private->SpiStream.ExitBootServicesEvent);
+    Private->SpiStream.ExitBootServicesEvent = NULL;
+  }
+  if (Private->SpiWrite.BusyEvent != NULL) {
+    gBS->CloseEvent(Private->SpiWrite.BusyEvent);
+    Private->SpiWrite.BusyEvent = NULL;
+  }
+}
+
+/**
+  Tells the card how many blocks the next CMD25 will write, so it can erase
+  them ahead of the data instead of while the data streams in.
+
+  Pre-erase is a hint; a failure here never fails the write. A card that
+  reports ACMD23 as illegal is remembered and not asked again.
+**/
+STATIC
+VOID
+SdCardPreEraseSpi (
+  IN SD_CARD_PRIVATE_DATA  *Private,
+  IN UINTN                 BlockCount
+  )
+{
+  EFI_STATUS Status;
+  UINT8      Response;
+
+  if (Private->SpiWrite.PreEraseUnsupported || Private->CardType == CARD_TYPE_MMC) {
+    return;
+  }
+
+  Status = SdCardSendCommandSpi(Private, CMD55, 0, &Response);
+  if (!EFI_ERROR(Status) && Response == 0) {
+    Status = SdCardSendCommandSpi(Private, ACMD23, (UINT32)MIN(BlockCount, ACMD23_MAX_BLOCK_COUNT), &Response);
+  }
+
+  if (Status == EFI_UNSUPPORTED) {
+    DEBUG((DEBUG_INFO, "SdCardSpi: Card rejects ACMD23, writing without pre-erase\n"));
+    Private->SpiWrite.PreEraseUnsupported = TRUE;
+  } else if (EFI_ERROR(Status) || Response != 0) {
+    DEBUG((DEBUG_WARN, "SdCardSpi: ACMD23 pre-erase of %u blocks failed: %r, 0x%x\n", BlockCount, Status, Response));
+  }
+}
+
+/**
+  Issues one SPI mode block write.
+
+  Multi-block writes announce their length with ACMD23 before CMD25.
+  @param[out] Sent  Blocks whose data the card accepted
+**/
+STATIC
+EFI_STATUS
+SdCardIssueWriteSpi (
+  IN  SD_CARD_PRIVATE_DATA  *Private,
+  IN  EFI_LBA               Lba,
+  IN  UINTN                 BlockCount,
+  IN  CONST UINT8           *Buffer,
+  OUT UINTN                 *Sent
   )
 {
   EFI_STATUS Status = EFI_SUCCESS;
-  UINTN BlockCount = BufferSize / SD_BLOCK_SIZE;
-  UINT8 *CurrentBuffer = (UINT8*)Buffer;
+  CONST UINT8 *CurrentBuffer = Buffer;
   UINT8 Response;
   UINT32 Address;
 
   Address = (Private->CardType == CARD_TYPE_SD_V2_HC) ? (UINT32)Lba : (UINT32)(Lba * SD_BLOCK_SIZE);
+  *Sent = 0;
 
   if (BlockCount > 1) {
-    // Multi-block
-    UINT8 Command = IsWrite ? CMD25 : CMD18;
-    Status = SdCardSendCommandSpi(Private, Command, Address, &Response);
+    // Multi-block write
+    SdCardPreEraseSpi(Private, BlockCount);
+    Status = SdCardSendCommandSpi(Private, CMD25, Address, &Response);
     if (EFI_ERROR(Status) || (Response & 0x80) != 0) {
       return EFI_DEVICE_ERROR;
     }
 
+    // Each block's CRC is computed while the card programs the one before;
+    // the first block's is computed as it is copied into the batch
+    UINT16 Crc = 0;
     for (UINTN i = 0; i < BlockCount; i++) {
-      if (IsWrite) {
-        Status = SdCardWriteDataBlockSpi(Private, DATA_TOKEN_WRITE_MULTI, SD_BLOCK_SIZE, CurrentBuffer);
-      } else {
-        Status = SdCardReadDataBlockSpi(Private, SD_BLOCK_SIZE, CurrentBuffer);
-      }
+      Status = SdCardSendDataBlockSpi(Private, DATA_TOKEN_WRITE_MULTI, SD_BLOCK_SIZE, CurrentBuffer, (i == 0) ? NULL : &Crc);
       if (EFI_ERROR(Status)) {
         break;
       }
+      (*Sent)++;
       CurrentBuffer += SD_BLOCK_SIZE;
+      if (i + 1 < BlockCount) {
+        Crc = SdCardCalculateCrc16(CurrentBuffer, SD_BLOCK_SIZE);
+      }
     }
 
-    if (IsWrite) {
-      // stop transmission token for multi-write
+    // Stop transmission token for multi-write plus the stuff byte before
+    // busy starts, once the last block has been programmed. The busy that
+    // follows is left to the next command.
+    EFI_STATUS BusyStatus = SdCardFinishWriteSpi(Private);
+    if (!EFI_ERROR(BusyStatus)) {
       UINT8 StopToken = DATA_TOKEN_WRITE_MULTI_STOP;
-      SpiTransferBuffer(Private, &StopToken, NULL, 1);
-      Status = SdCardWaitNotBusySpi(Private);
-    } else {
-      if (EFI_ERROR(Status)) {
-        // Attempt to stop transmission on card
-        SdCardSendCommandSpi(Private, CMD12, 0, &Response);
+      BusyStatus = SpiBatchQueue(Private, &StopToken, NULL, 1);
+      if (!EFI_ERROR(BusyStatus)) {
+        BusyStatus = SpiBatchQueue(Private, NULL, NULL, 1);
+      }
+      if (!EFI_ERROR(BusyStatus)) {
+        BusyStatus = SpiBatchFlush(Private);
+      } else {
+        SpiBatchDiscard(Private);
       }
+      Private->SpiWrite.BusyPending = TRUE;
+    }
+    if (!EFI_ERROR(Status)) {
+      Status = BusyStatus;
     }
   } else {
     // Single block
-    UINT8 Command = IsWrite ? CMD24 : CMD17;
-    Status = SdCardSendCommandSpi(Private, Command, Address, &Response);
+    Status = SdCardSendCommandSpi(Private, CMD24, Address, &Response);
     if (EFI_ERROR(Status) || (Response & 0x80) != 0) {
       return EFI_DEVICE_ERROR;
     }
 
-    if (IsWrite) {
-      Status = SdCardWriteDataBlockSpi(Private, DATA_TOKEN_WRITE_SINGLE, SD_BLOCK_SIZE, CurrentBuffer);
-    } else {
-      Status = SdCardReadDataBlockSpi(Private, SD_BLOCK_SIZE, CurrentBuffer);
-    }
+    Status = SdCardWriteDataBlockSpi(Private, DATA_TOKEN_WRITE_SINGLE, SD_BLOCK_SIZE, CurrentBuffer);
+    *Sent = EFI_ERROR(Status) ? 0 : 1;
+  }
+
+  return Status;
+}
+
+/**
+  Asks the card with ACMD22 how many blocks of the last write it committed.
+
+  The card has to finish programming first, which the command's busy wait
+  takes care of.
+**/
+STATIC
+EFI_STATUS
+SdCardGetWrittenBlocksSpi (
+  IN  SD_CARD_PRIVATE_DATA  *Private,
+  OUT UINT32                *Written
+  )
+{
+  EFI_STATUS Status;
+  UINT8      Response;
+  UINT8      Count[SD_NUM_WR_BLOCKS_SIZE];
+
+  Status = SdCardSendCommandSpi(Private, CMD55, 0, &Response);
+  if (!EFI_ERROR(Status) && Response == 0) {
+    Status = SdCardSendCommandSpi(Private, ACMD22, 0, &Response);
+  }
+  if (EFI_ERROR(Status) || Response != 0) {
+    DEBUG((DEBUG_WARN, "SdCardSpi: ACMD22 failed: %r, 0x%x\n", Status, Response));
+    return EFI_ERROR(Status) ? Status : EFI_DEVICE_ERROR;
+  }
+
+  Status = SdCardReadDataBlockSpi(Private, sizeof(Count), Count);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  *Written = ((UINT32)Count[0] << 24) | ((UINT32)Count[1] << 16) | ((UINT32)Count[2] << 8) | Count[3];
+  return EFI_SUCCESS;
+}
+
+/**
+  Writes blocks in SPI mode, resuming from the first uncommitted block on
+  error.
+
+  After a failed multi-block write the card is asked with ACMD22 how many
+  blocks it committed, and after the backoff from the write retry policy the
+  write is re-issued from the first block it did not. If the count cannot be
+  read the whole attempt is repeated. Every failure is reported to the clock
+  monitor.
+**/
+STATIC
+EFI_STATUS
+SdCardWriteBlocksSpi (
+  IN  SD_CARD_PRIVATE_DATA  *Private,
+  IN  EFI_LBA               Lba,
+  IN  UINTN                 BlockCount,
+  IN  CONST UINT8           *Buffer
+  )
+{
+  STATIC CONST UINT32 BackoffMs[SD_CARD_SPI_WRITE_MAX_RETRIES] = SD_CARD_SPI_WRITE_BACKOFF_MS;
+  EFI_STATUS Status;
+  UINTN Done;
+  UINTN Sent;
+  UINTN Attempt;
+  UINT32 Written;
+
+  // Any read position is forgotten after a write
+  Private->SpiStream.NextLba = MAX_UINT64;
+
+  Done = 0;
+  Status = SdCardIssueWriteSpi(Private, Lba, BlockCount, Buffer, &Sent);
+
+  for (Attempt = 0; EFI_ERROR(Status) && Status != EFI_NO_MEDIA; Attempt++) {
+    SdCardMonitorClockSpi(Private, Status);
+
+    // Only a CMD25 that got as far as data leaves committed blocks behind
+    if (Sent > 0 && BlockCount - Done > 1 && !EFI_ERROR(SdCardGetWrittenBlocksSpi(Private, &Written))) {
+      Done += MIN((UINTN)Written, Sent);
+    }
+    if (Done == BlockCount) {
+      // Only the stop or the final busy failed; every block is on the card
+      Status = EFI_SUCCESS;
+      break;
+    }
+
+    if (Attempt >= SD_CARD_SPI_WRITE_MAX_RETRIES) {
+      break;
+    }
+
+    DEBUG((DEBUG_WARN, "SdCardSpi: Write failed at LBA %lu (%r), resuming after %u ms at %u Hz\n",
+           Lba + Done, Status, BackoffMs[Attempt], Private->CurrentClockHz));
+    gBS->Stall(BackoffMs[Attempt] * 1000);
+
+    Status = SdCardIssueWriteSpi(Private, Lba + Done, BlockCount - Done, Buffer + Done * SD_BLOCK_SIZE, &Sent);
+  }
+
+  if (!EFI_ERROR(Status)) {
+    SdCardMonitorClockSpi(Private, EFI_SUCCESS);
+  }
+
+  return Status;
+}
+
+/**
+  Erases a block range with CMD32, CMD33 and CMD38 and waits out the erase.
+
+  The busy timeout is the per-AU erase timeout times the number of AUs,
+  plus the erase offset.
+**/
+STATIC
+EFI_STATUS
+SdCardEraseBlocksSpi (
+  IN SD_CARD_PRIVATE_DATA  *Private,
+  IN EFI_LBA               Lba,
+  IN UINTN                 BlockCount
+  )
+{
+  SD_CARD_SPI_WRITE *Write = &Private->SpiWrite;
+  EFI_STATUS Status;
+  EFI_LBA Last;
+  UINT8 Response;
+  UINT8 Burst[SD_CARD_SPI_POLL_BURST_MAX];
+  UINTN Received;
+  UINT64 TimeoutUs;
+
+  Private->SpiStream.NextLba = MAX_UINT64;
+  Last = Lba + BlockCount - 1;
+  if (Private->CardType != CARD_TYPE_SD_V2_HC) {
+    Lba  *= SD_BLOCK_SIZE;
+    Last *= SD_BLOCK_SIZE;
+  }
+
+  Status = SdCardSendCommandSpi(Private, CMD32, (UINT32)Lba, &Response);
+  if (!EFI_ERROR(Status) && Response == 0) {
+    Status = SdCardSendCommandSpi(Private, CMD33, (UINT32)Last, &Response);
+  }
+  if (!EFI_ERROR(Status) && Response == 0) {
+    Status = SdCardSendCommandSpi(Private, CMD38, 0, &Response);
+  }
+  if (EFI_ERROR(Status) || Response != 0) {
+    DEBUG((DEBUG_WARN, "SdCardSpi: Erase command failed: %r, 0x%x\n", Status, Response));
+    return EFI_ERROR(Status) ? Status : EFI_DEVICE_ERROR;
+  }
+
+  TimeoutUs = (UINT64)Write->EraseTimeoutPerAuUs * (BlockCount / Write->EraseBlocks) + Write->EraseOffsetUs;
+  Status = SdCardPollSpi(Private, FALSE, (UINT32)MIN(TimeoutUs, MAX_UINT32), 1, sizeof(Burst), Burst, &Received, NULL);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_ERROR, "SdCardSpi: Erase of %u blocks at LBA %lu timed out\n", BlockCount, Lba));
+  }
+
+  return Status;
+}
+
+/**
+  Writes blocks, turning all-zero runs of at least one whole AU into erases.
+
+  Only used when erased blocks read back as zero. Each zero run is trimmed to
+  AU boundaries; the blocks outside them, and any run whose erase fails, are
+  written as data.
+**/
+STATIC
+EFI_STATUS
+SdCardWriteOrEraseSpi (
+  IN  SD_CARD_PRIVATE_DATA  *Private,
+  IN  EFI_LBA               Lba,
+  IN  UINTN                 BlockCount,
+  IN  CONST UINT8           *Buffer
+  )
+{
+  UINTN AuBlocks = Private->SpiWrite.EraseBlocks;
+  EFI_STATUS Status;
+  UINTN Start;
+  UINTN Index;
+  UINTN Run;
+  UINTN EraseStart;
+  UINTN EraseEnd;
+
+  Start = 0;
+  Index = 0;
+  while (Index + AuBlocks <= BlockCount) {
+    if (!IsZeroBuffer(Buffer + Index * SD_BLOCK_SIZE, SD_BLOCK_SIZE)) {
+      Index++;
+      continue;
+    }
+
+    for (Run = Index + 1; Run < BlockCount && IsZeroBuffer(Buffer + Run * SD_BLOCK_SIZE, SD_BLOCK_SIZE); Run++) {
+    }
+
+    // Whole AUs inside the run, as offsets into the request
+    EraseStart = (UINTN)(MultU64x32(DivU64x32(Lba + Index + AuBlocks - 1, (UINT32)AuBlocks), (UINT32)AuBlocks) - Lba);
+    EraseEnd   = (UINTN)(MultU64x32(DivU64x32(Lba + Run, (UINT32)AuBlocks), (UINT32)AuBlocks) - Lba);
+    if (EraseEnd > EraseStart && EraseEnd - EraseStart >= AuBlocks &&
+        !EFI_ERROR(SdCardEraseBlocksSpi(Private, Lba + EraseStart, EraseEnd - EraseStart))) {
+      if (EraseStart > Start) {
+        Status = SdCardWriteBlocksSpi(Private, Lba + Start, EraseStart - Start, Buffer + Start * SD_BLOCK_SIZE);
+        if (EFI_ERROR(Status)) {
+          return Status;
+        }
+      }
+      Start = EraseEnd;
+    }
+    Index = Run;
+  }
+
+  if (Start == BlockCount) {
+    return EFI_SUCCESS;
+  }
+
+  return SdCardWriteBlocksSpi(Private, Lba + Start, BlockCount - Start, Buffer + Start * SD_BLOCK_SIZE);
+}
+
+/**
+  SPI mode read/write function.
+
+  Reads and writes retry and resume internally. Writes covering whole
+  all-zero AUs erase them instead, when the card reads erased blocks as zero.
+**/
+EFI_STATUS
+EFIAPI
+SdCardExecuteReadWriteSpi (
+  IN  SD_CARD_PRIVATE_DATA  *Private,
+  IN  EFI_LBA               Lba,
+  IN  UINTN                 BufferSize,
+  IN OUT  VOID                  *Buffer,
+  IN  BOOLEAN               IsWrite
+  )
+{
+  EFI_STATUS Status;
+  UINTN BlockCount = BufferSize / SD_BLOCK_SIZE;
+  UINT64 TransactionsBefore = Private->SpiArena.TransactionCount;
+  UINT64 AllocationsBefore = Private->SpiArena.PoolAllocations;
+
+  if (IsWrite && Private->SpiWrite.EraseBlocks != 0 && BlockCount >= Private->SpiWrite.EraseBlocks) {
+    Status = SdCardWriteOrEraseSpi(Private, Lba, BlockCount, (CONST UINT8*)Buffer);
+  } else if (IsWrite) {
+    Status = SdCardWriteBlocksSpi(Private, Lba, BlockCount, (CONST UINT8*)Buffer);
+  } else {
+    Status = SdCardReadBlocksSpi(Private, Lba, BlockCount, (UINT8*)Buffer);
+  }
+
+  // The card programs the last write while the caller moves on; the busy
+  // check timer watches for it instead of the next request spinning on it
+  if (Private->SpiWrite.BusyPending && Private->SpiWrite.BusyEvent != NULL) {
+    gBS->SetTimer(Private->SpiWrite.BusyEvent, TimerPeriodic, EFI_TIMER_PERIOD_MICROSECONDS(SD_CARD_SPI_BUSY_CHECK_US));
+  }
+
+  DEBUG((DEBUG_VERBOSE, "SdCardSpi: %a LBA %lu x%u: %lu transactions, %lu pool allocations\n",
+         IsWrite ? "Write" : "Read", Lba, BlockCount,
+         Private->SpiArena.TransactionCount - TransactionsBefore,
+         Private->SpiArena.PoolAllocations - AllocationsBefore));
+
+  return Status;
+}
+/**
+  Clocks the card into SPI mode and identifies it with CMD0 and CMD8.
+  This is the first of the three SPI initialization phases; the card is left
+  in the idle state, ready for ACMD41.
+**/
+EFI_STATUS
+EFIAPI
+SdCardIdentifySpi (
+  IN SD_CARD_PRIVATE_DATA   *Private
+  )
+{
+  EFI_STATUS Status;
+  UINT8      Response;
+  UINT8      Ocr[4];
+
+  Private->IsInitialized = FALSE;
+  Private->BlockMedia.MediaPresent = FALSE;
+
+  // CMD0 resets the card, so any open read stream is gone, and the card may
+  // have been swapped since its capabilities were learned
+  Private->SpiStream.Open = FALSE;
+  Private->SpiStream.NextLba = MAX_UINT64;
+  Private->SpiWrite.PreEraseUnsupported = FALSE;
+  Private->SpiWrite.BusyPending = FALSE;
+  Private->SpiWrite.BusyTimeoutUs = 0;
+  Private->SpiWrite.EraseBlocks = 0;
+
+  // Identification runs at the slow clock every SD card accepts
+  Status = SpiSetClock(Private, SPI_INIT_CLOCK_HZ);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_WARN, "SDCard: Unable to set %u Hz identification clock: %r\n", SPI_INIT_CLOCK_HZ, Status));
+  }
+
+// Add to SdCardInitializeSpi() before CMD0
+// Send 80+ dummy clocks with CS deasserted and DI/MOSI high
+UINT8 dummyClocks[10];
+SetMem(dummyClocks, sizeof(dummyClocks), 0xFF);
+SpiDeassertCs(Private);
+SpiTransferBuffer(Private, dummyClocks, NULL, sizeof(dummyClocks));
+SpiAssertCs(Private);
+
+  // CMD0: Reset card to SPI mode
+  Status = SdCardSendCommandSpi(Private, CMD0, 0, &Response);
+  if (EFI_ERROR(Status) || Response != R1_IDLE_STATE) {
+    DEBUG((DEBUG_ERROR, "SDCard: CMD0 failed. Response: 0x%x, Status: %r\n", Response, Status));
+    return EFI_DEVICE_ERROR;
+  }
+
+  // CMD8: Check voltage range and pattern
+  Status = SdCardSendCommandExSpi(Private, CMD8, CMD8_ARG_V2, &Response, Ocr);
+  if (Status == EFI_SUCCESS && (Response & R1_IDLE_STATE)) {
+    Private->CardType = CARD_TYPE_SD_V2_SC;
+    if (Ocr[3] != CMD8_CHECK_PATTERN) {
+      DEBUG((DEBUG_ERROR, "SDCard: CMD8 check pattern mismatch\n"));
+      return EFI_DEVICE_ERROR;
+    }
+  } else {
+    // For v1 cards or non-responsive cards, set to v1
+    Private->CardType = CARD_TYPE_SD_V1;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Issues one round of ACMD41 in SPI mode.
+  @param[in]  Private  SD card private data
+  @param[out] Ready    TRUE once the card has left the idle state
+  @return EFI_STATUS of the command exchange
+**/
+EFI_STATUS
+EFIAPI
+SdCardPollOpCondSpi (
+  IN  SD_CARD_PRIVATE_DATA  *Private,
+  OUT BOOLEAN               *Ready
+  )
+{
+  EFI_STATUS Status;
+  UINT8      Response;
+
+  *Ready = FALSE;
+
+  // send CMD55
+  Status = SdCardSendCommandSpi(Private, CMD55, 0, &Response);
+  if (EFI_ERROR(Status) || (Response & R1_ILLEGAL_COMMAND)) {
+    // If CMD55 fails or is illegal, try direct ACMD41 (some cards might not support CMD55)
+    Status = SdCardSendCommandSpi(Private, ACMD41, 0, &Response);
+  } else {
+    // ACMD41 with HCS if v2
+    UINT32 Arg = (Private->CardType == CARD_TYPE_SD_V2_SC) ? ACMD41_ARG_HCS : 0;
+    Status = SdCardSendCommandSpi(Private, ACMD41, Arg, &Response);
+  }
+
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_ERROR, "SDCard: ACMD41 failed. Response: 0x%x, Status: %r\n", Response, Status));
+    return Status;
+  }
+
+  *Ready = (BOOLEAN)((Response & R1_IDLE_STATE) == 0);
+  return EFI_SUCCESS;
+}
+
+/**
+  Reads the CID, OCR and CSD once ACMD41 has taken the card out of idle and
+  sets the block length. A card matching the warm boot record takes its OCR
+  and CSD from the record instead.
+**/
+EFI_STATUS
+EFIAPI
+SdCardReadRegistersSpi (
+  IN SD_CARD_PRIVATE_DATA   *Private
+  )
+{
+  EFI_STATUS Status;
+  UINT8      Response;
+  UINT8      Ocr[4];
+  UINT8      Csd[CSD_REGISTER_SIZE];
+
+  // CMD10: the CID tells whether this is the card remembered from last boot
+  Status = SdCardReadCidSpi(Private, Private->Cid);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  if (SdCardMatchWarmBoot(Private)) {
+    // Same card: OCR, card type and CSD come from the record
+    CopyMem(Private->Ocr, Private->WarmBoot.Cached.Ocr, sizeof(Private->Ocr));
+    CopyMem(Csd, Private->WarmBoot.Cached.Csd, sizeof(Csd));
+    Private->CardType = (CARD_TYPE)Private->WarmBoot.Cached.CardType;
+  } else {
+    // CMD58: Read OCR and detect CCS for HC
+    if (Private->CardType == CARD_TYPE_SD_V2_SC) {
+      Status = SdCardSendCommandExSpi(Private, CMD58, 0, &Response, Ocr);
+      if (EFI_ERROR(Status) || (Response != 0 && Response != R1_IDLE_STATE)) {
+        DEBUG((DEBUG_ERROR, "SDCard: CMD58 failed\n"));
+        return EFI_DEVICE_ERROR;
+      }
+      CopyMem(Private->Ocr, Ocr, sizeof(Private->Ocr));
+      if (Ocr[0] & OCR_CCS_BIT) {
+        Private->CardType = CARD_TYPE_SD_V2_HC;
+      }
+    }
+
+    // CMD9: read CSD
+    Status = SdCardReadCsdSpi(Private, Csd);
+    if (EFI_ERROR(Status)) {
+      return Status;
+    }
+  }
+
+  // CMD16: set block length for standard capacity
+  if (Private->CardType != CARD_TYPE_SD_V2_HC) {
+    Status = SdCardSendCommandSpi(Private, CMD16, SD_BLOCK_SIZE, &Response);
+    if (EFI_ERROR(Status) || (Response != 0)) {
+      DEBUG((DEBUG_ERROR, "SDCard: CMD16 failed\n"));
+      return EFI_DEVICE_ERROR;
+    }
+  }
+
+  // Use the SPI-specific CSD parser instead of the generic one
+  Status = SdCardParseCsdSpi(Private, Csd);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_ERROR, "Failed to parse CSD register: %r\n", Status));
+    return Status;
+  }
+  CopyMem(Private->WarmBoot.Csd, Csd, sizeof(Private->WarmBoot.Csd));
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Brings the data clock up to the card's rated speed and switches the card
+  to High Speed where it supports it. Neither is required for the card to
+  be usable.
+**/
+VOID
+EFIAPI
+SdCardStartDataClockSpi (
+  IN SD_CARD_PRIVATE_DATA   *Private
+  )
+{
+  EFI_STATUS Status;
+
+  // Data phase: run at the card's rated clock, bounded by the platform limit
+  Status = SpiSetClock(Private, Private->MaxClockHz);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_WARN, "SDCard: Staying at %u Hz for data transfer: %r\n", Private->CurrentClockHz, Status));
+  }
+
+  // High Speed is optional; the card stays usable at default speed without it
+  Status = SdCardSwitchHighSpeedSpi(Private);
+  if (EFI_ERROR(Status) && Status != EFI_UNSUPPORTED) {
+    DEBUG((DEBUG_WARN, "SDCard: High Speed switch failed: %r\n", Status));
+  }
+}
+
+/**
+  Finishes SPI initialization once ACMD41 has taken the card out of idle:
+  reads the OCR and CSD and brings the data clock up to speed. Runs the
+  setup steps back to back; the init state machine runs them one per tick.
+**/
+EFI_STATUS
+EFIAPI
+SdCardCompleteInitSpi (
+  IN SD_CARD_PRIVATE_DATA   *Private
+  )
+{
+  EFI_STATUS Status;
+  BOOLEAN    Done;
+
+  Status = SdCardReadRegistersSpi(Private);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  SdCardStartDataClockSpi(Private);
+
+  // Find the fastest clock this board carries cleanly, or go straight to the
+  // one a remembered card ran at last boot
+  Status = SdCardStartTrainClockSpi(Private, &Done);
+  while (!EFI_ERROR(Status) && !Done) {
+    Status = SdCardTrainClockStepSpi(Private, &Done);
+  }
+  if (EFI_ERROR(Status) && Status != EFI_UNSUPPORTED) {
+    DEBUG((DEBUG_WARN, "SDCard: Clock training failed: %r\n", Status));
+  }
+
+  // Zero writes can become erases on cards that erase to zero
+  Status = SdCardProbeEraseSpi(Private);
+  if (EFI_ERROR(Status) && Status != EFI_UNSUPPORTED) {
+    DEBUG((DEBUG_WARN, "SDCard: Erase probe failed: %r\n", Status));
+  }
+
+  DEBUG((DEBUG_INFO, "SDCard: Initialized successfully. CardType: %d, LastBlock: %llu, Clock: %u Hz\n",
+         Private->CardType, Private->LastBlock, Private->CurrentClockHz));
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Initializes the SD card in SPI mode.
+**/
+EFI_STATUS
+EFIAPI
+SdCardInitializeSpi (
+  IN SD_CARD_PRIVATE_DATA   *Private
+  )
+{
+  EFI_STATUS Status;
+  BOOLEAN    Ready;
+  UINT64     StartNs;
+  UINT32     IntervalUs;
+  UINT32     Polls;
+
+  Status = SdCardIdentifySpi(Private);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  // ACMD41 initialize, polling quickly at first and backing off until the
+  // card leaves idle or PcdSdCardInitTimeoutMs runs out
+  StartNs    = GetTimeInNanoSecond(GetPerformanceCounter());
+  IntervalUs = SD_OP_COND_POLL_MIN_US;
+  Polls      = 0;
+  do {
+    Status = SdCardPollOpCondSpi(Private, &Ready);
+    Polls++;
+    if (EFI_ERROR(Status) || Ready) {
+      break;
+    }
+
+    Status = SdCardOpCondBackoff(StartNs, &IntervalUs);
+  } while (!EFI_ERROR(Status));
+
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_ERROR, "SDCard: Initialization timeout or error after %u polls: %r\n", Polls, Status));
+    return EFI_TIMEOUT;
+  }
+
+  Private->OpCondReadyUs = SdCardOpCondElapsedUs(StartNs);
+  DEBUG((DEBUG_INFO, "SDCard: Card ready after %u us (%u ACMD41 polls)\n", Private->OpCondReadyUs, Polls));
+
+  return SdCardCompleteInitSpi(Private);
+}
+
+
+/**
+  Reads the CSD register with CMD9 in SPI mode.
+**/
+EFI_STATUS
+EFIAPI
+SdCardReadCsdSpi (
+  IN  SD_CARD_PRIVATE_DATA  *Private,
+  OUT UINT8                 *Csd
+  )
+{
+  EFI_STATUS Status;
+  UINT8      Response;
+
+  Status = SdCardSendCommandSpi(Private, CMD9, 0, &Response);
+  if (EFI_ERROR(Status) || (Response != 0 && Response != R1_IDLE_STATE)) {
+    DEBUG((DEBUG_ERROR, "SDCard: CMD9 failed\n"));
+    return EFI_DEVICE_ERROR;
+  }
+
+  Status = SdCardReadDataBlockSpi(Private, CSD_REGISTER_SIZE, Csd);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_ERROR, "SDCard: Failed to read CSD\n"));
+  }
+
+  return Status;
+}
+
+/**
+  Reads the CID register with CMD10 in SPI mode.
+**/
+STATIC
+EFI_STATUS
+SdCardReadCidSpi (
+  IN  SD_CARD_PRIVATE_DATA  *Private,
+  OUT UINT8                 *Cid
+  )
+{
+  EFI_STATUS Status;
+  UINT8      Response;
+
+  Status = SdCardSendCommandSpi(Private, CMD10, 0, &Response);
+  if (EFI_ERROR(Status) || (Response != 0 && Response != R1_IDLE_STATE)) {
+    DEBUG((DEBUG_ERROR, "SDCard: CMD10 failed\n"));
+    return EFI_DEVICE_ERROR;
+  }
+
+  Status = SdCardReadDataBlockSpi(Private, CID_REGISTER_SIZE, Cid);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_ERROR, "SDCard: Failed to read CID\n"));
+  }
+
+  return Status;
+}
+
+/**
+  Issues an application command that returns a data block, such as SCR or
+  SD Status, and reads the block.
+**/
+STATIC
+EFI_STATUS
+SdCardReadAppRegisterSpi (
+  IN  SD_CARD_PRIVATE_DATA  *Private,
+  IN  UINT8                 Command,
+  IN  UINTN                 Length,
+  OUT UINT8                 *Buffer
+  )
+{
+  EFI_STATUS Status;
+  UINT8      Response;
+
+  Status = SdCardSendCommandSpi(Private, CMD55, 0, &Response);
+  if (!EFI_ERROR(Status) && Response == 0) {
+    Status = SdCardSendCommandSpi(Private, Command, 0, &Response);
+  }
+  if (EFI_ERROR(Status) || Response != 0) {
+    DEBUG((DEBUG_WARN, "SDCard: ACMD%d failed: %r, 0x%x\n", Command, Status, Response));
+    return EFI_ERROR(Status) ? Status : EFI_DEVICE_ERROR;
+  }
+
+  return SdCardReadDataBlockSpi(Private, Length, Buffer);
+}
+
+/**
+  Reads the SCR and, if erased blocks read back as zero, the AU size and
+  erase timing from the SD Status.
+
+  Sets Private->SpiWrite.EraseBlocks when all-zero writes may be turned into
+  erases.
+  @return EFI_UNSUPPORTED if the card erases to ones or has no AU size
+**/
+EFI_STATUS
+EFIAPI
+SdCardProbeEraseSpi (
+  IN SD_CARD_PRIVATE_DATA  *Private
+  )
+{
+  SD_CARD_SPI_WRITE *Write = &Private->SpiWrite;
+  EFI_STATUS Status;
+  UINT8      SdStatus[SD_STATUS_SIZE];
+  UINT32     AuKb;
+  UINT16     EraseSize;
+  UINT8      EraseTimeout;
+
+  Write->EraseBlocks = 0;
+
+  if (Private->WarmBoot.Hit) {
+    CopyMem(Private->Scr, Private->WarmBoot.Cached.Scr, sizeof(Private->Scr));
+  } else {
+    Status = SdCardReadAppRegisterSpi(Private, ACMD51, SCR_REGISTER_SIZE, Private->Scr);
+    if (EFI_ERROR(Status)) {
+      return Status;
+    }
+  }
+  if ((Private->Scr[1] & SCR_DATA_STAT_AFTER_ERASE) != 0) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Status = SdCardReadAppRegisterSpi(Private, ACMD13, SD_STATUS_SIZE, SdStatus);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  // AU_SIZE is bits [431:428], ERASE_SIZE [423:408], ERASE_TIMEOUT [407:402]
+  // and ERASE_OFFSET [401:400]
+  AuKb = SdCardDecodeAuSize(SdStatus[10] >> 4);
+  if (AuKb == 0) {
+    return EFI_UNSUPPORTED;
+  }
+  EraseSize    = (UINT16)((SdStatus[11] << 8) | SdStatus[12]);
+  EraseTimeout = SdStatus[13] >> 2;
+
+  Write->EraseTimeoutPerAuUs = (EraseSize != 0 && EraseTimeout != 0) ?
+                               (UINT32)(EraseTimeout * 1000000U / EraseSize) : SD_ERASE_TIMEOUT_PER_AU_US;
+  Write->EraseOffsetUs       = (SdStatus[13] & 0x03) * 1000000U;
+  Write->EraseBlocks         = AuKb * 1024 / SD_BLOCK_SIZE;
+
+  DEBUG((DEBUG_INFO, "SDCard: Zero writes of %u KB AUs become erases (%u us per AU)\n",
+         AuKb, Write->EraseTimeoutPerAuUs));
+  return EFI_SUCCESS;
+}
+
+/**
+  Issues CMD6 in SPI mode and reads the 64-byte switch status block.
+**/
+STATIC
+EFI_STATUS
+SdCardSwitchFunctionSpi (
+  IN  SD_CARD_PRIVATE_DATA  *Private,
+  IN  UINT32                Argument,
+  OUT UINT8                 *SwitchStatus
+  )
+{
+  EFI_STATUS Status;
+  UINT8      Response;
+
+  Status = SdCardSendCommandSpi(Private, CMD6, Argument, &Response);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  if (Response != 0) {
+    DEBUG((DEBUG_WARN, "SDCard: CMD6 0x%08x rejected. Response: 0x%x\n", Argument, Response));
+    return EFI_DEVICE_ERROR;
+  }
+
+  return SdCardReadDataBlockSpi(Private, SD_SWITCH_STATUS_SIZE, SwitchStatus);
+}
+
+/**
+  Switches the card to High Speed mode and raises the SPI clock.
+
+  The card must implement command class 10 and advertise High Speed in the
+  CMD6 query before the switch is made. After switching, the clock is raised
+  to the card's new TRAN_SPEED and the CSD is read back as a CRC-checked probe;
+  if the card or board cannot sustain the faster clock the driver drops back
+  to the default-speed clock, which High Speed cards still accept.
+  @return EFI_UNSUPPORTED if the card or platform cannot use High Speed
+**/
+EFI_STATUS
+EFIAPI
+SdCardSwitchHighSpeedSpi (
+  IN SD_CARD_PRIVATE_DATA  *Private
+  )
+{
+  EFI_STATUS Status;
+  UINT8      SwitchStatus[SD_SWITCH_STATUS_SIZE];
+  UINT8      Csd[CSD_REGISTER_SIZE];
+  UINT16     Ccc;
+  UINT32     HighSpeedHz;
+
+  // CCC is CSD bits [95:84]
+  Ccc = (UINT16)((Private->Csd[4] << 4) | (Private->Csd[5] >> 4));
+  if ((Ccc & SD_CCC_SWITCH) == 0) {
+    return EFI_UNSUPPORTED;
+  }
+
+  if (PcdGet32(PcdSdCardSpiMaxClockHz) <= SPI_MAX_CLOCK_HZ) {
+    DEBUG((DEBUG_INFO, "SDCard: Platform SPI clock limit does not allow High Speed\n"));
+    return EFI_UNSUPPORTED;
+  }
+
+  // Query: group 1 support bits are status bits [415:400]
+  Status = SdCardSwitchFunctionSpi(Private, CMD6_MODE_CHECK | CMD6_ARG_GROUP1_HIGH_SPEED, SwitchStatus);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  if ((SwitchStatus[13] & BIT1) == 0) {
+    DEBUG((DEBUG_INFO, "SDCard: Card does not support High Speed\n"));
+    return EFI_UNSUPPORTED;
+  }
+
+  // Switch: the group 1 result is status bits [379:376]
+  Status = SdCardSwitchFunctionSpi(Private, CMD6_MODE_SWITCH | CMD6_ARG_GROUP1_HIGH_SPEED, SwitchStatus);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  if ((SwitchStatus[16] & 0x0F) != 1) {
+    DEBUG((DEBUG_WARN, "SDCard: High Speed switch refused. Result: 0x%x\n", SwitchStatus[16] & 0x0F));
+    return EFI_UNSUPPORTED;
+  }
+
+  // The card reports its new TRAN_SPEED once the switch has taken effect
+  HighSpeedHz = SPI_HIGH_SPEED_CLOCK_HZ;
+  Status = SdCardReadCsdSpi(Private, Csd);
+  if (!EFI_ERROR(Status) && SdCardDecodeTranSpeed(Csd[3]) > SPI_MAX_CLOCK_HZ) {
+    HighSpeedHz = SdCardDecodeTranSpeed(Csd[3]);
+  }
+
+  Status = SpiSetClock(Private, HighSpeedHz);
+  if (!EFI_ERROR(Status)) {
+    Status = SdCardReadCsdSpi(Private, Csd);
+  }
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_WARN, "SDCard: %u Hz not sustainable (%r), using %u Hz\n",
+           HighSpeedHz, Status, SPI_MAX_CLOCK_HZ));
+    SpiSetClock(Private, SPI_MAX_CLOCK_HZ);
+    Private->MaxClockHz = SPI_MAX_CLOCK_HZ;
+    return EFI_SUCCESS;
+  }
+
+  CopyMem(Private->Csd, Csd, sizeof(Private->Csd));
+  Private->MaxClockHz = HighSpeedHz;
+  DEBUG((DEBUG_INFO, "SDCard: High Speed enabled at %u Hz\n", Private->CurrentClockHz));
+  return EFI_SUCCESS;
+}
+
+/**
+  Reads LBA 0 with CMD17 at the current clock.
+**/
+STATIC
+EFI_STATUS
+SdCardReadTrainingBlockSpi (
+  IN  SD_CARD_PRIVATE_DATA  *Private,
+  OUT UINT8                 *Buffer
+  )
+{
+  EFI_STATUS Status;
+  UINT8      Response;
+
+  Status = SdCardSendCommandSpi(Private, CMD17, 0, &Response);
+  if (EFI_ERROR(Status) || Response != 0) {
+    return EFI_ERROR(Status) ? Status : EFI_DEVICE_ERROR;
+  }
+
+  return SdCardReadDataBlockSpi(Private, SD_BLOCK_SIZE, Buffer);
+}
+
+/**
+  Moves the data clock to a step on the clock ladder.
+**/
+STATIC
+EFI_STATUS
+SdCardSetClockStepSpi (
+  IN SD_CARD_PRIVATE_DATA  *Private,
+  IN UINT32                StepIndex
+  )
+{
+  Private->SpiClock.StepIndex = StepIndex;
+  return SpiSetClock(Private, mSdCardSpiClockLadder[StepIndex]);
+}
+
+/**
+  Clears the clock monitor and sets its ceiling to the highest ladder step
+  the card's maximum clock allows.
+  @return EFI_UNSUPPORTED if the card is slower than the lowest step
+**/
+STATIC
+EFI_STATUS
+SdCardResetClockMonitorSpi (
+  IN SD_CARD_PRIVATE_DATA  *Private
+  )
+{
+  SD_CARD_SPI_CLOCK_MONITOR *Monitor;
+  UINT32                    Step;
+
+  Monitor = &Private->SpiClock;
+  ZeroMem(Monitor, sizeof(*Monitor));
+  Monitor->UpshiftWindow = SD_CARD_SPI_CLEAN_WINDOW;
+  if (Private->MaxClockHz < mSdCardSpiClockLadder[0]) {
+    return EFI_UNSUPPORTED;
+  }
+
+  for (Step = 0; Step + 1 < ARRAY_SIZE(mSdCardSpiClockLadder); Step++) {
+    if (mSdCardSpiClockLadder[Step + 1] > Private->MaxClockHz) {
+      break;
+    }
+  }
+  Monitor->CeilingIndex = Step;
+  return EFI_SUCCESS;
+}
+
+/**
+  Starts the data clock at the highest ladder step not above a clock this
+  card already ran cleanly at, without training. The monitor still lowers
+  the clock if the board no longer carries it.
+  @param[in] Private  SD card private data
+  @param[in] ClockHz  Data clock remembered from an earlier boot
+**/
+STATIC
+EFI_STATUS
+SdCardRestoreClockSpi (
+  IN SD_CARD_PRIVATE_DATA  *Private,
+  IN UINT32                ClockHz
+  )
+{
+  SD_CARD_SPI_CLOCK_MONITOR *Monitor;
+  UINT32                    Step;
+  EFI_STATUS                Status;
+
+  Monitor = &Private->SpiClock;
+  Status = SdCardResetClockMonitorSpi(Private);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  Step = Monitor->CeilingIndex;
+  while (Step > 0 && mSdCardSpiClockLadder[Step] > ClockHz) {
+    Step--;
+  }
+
+  Status = SdCardSetClockStepSpi(Private, Step);
+  Monitor->Trained = TRUE;
+  DEBUG((DEBUG_INFO, "SDCard: Restored data clock %u Hz (ceiling %u Hz)\n",
+         Private->CurrentClockHz, mSdCardSpiClockLadder[Monitor->CeilingIndex]));
+  return Status;
+}
+
+/**
+  Settles the data clock on the highest step that passed training and hands
+  it to the run-time monitor.
+**/
+STATIC
+EFI_STATUS
+SdCardEndTrainClockSpi (
+  IN SD_CARD_PRIVATE_DATA  *Private
+  )
+{
+  SD_CARD_SPI_CLOCK_MONITOR *Monitor;
+  EFI_STATUS                Status;
+
+  Monitor = &Private->SpiClock;
+  Status = SdCardSetClockStepSpi(Private, Monitor->BestIndex);
+  Monitor->Trained = TRUE;
+  DEBUG((DEBUG_INFO, "SDCard: Trained data clock %u Hz (ceiling %u Hz)\n",
+         Private->CurrentClockHz, mSdCardSpiClockLadder[Monitor->CeilingIndex]));
+  return Status;
+}
+
+/**
+  Starts training the SPI data clock against the board.
+
+  LBA 0 is read at the bottom of the clock ladder as the reference that
+  SdCardTrainClockStepSpi compares against. A card matching the warm boot
+  record skips training and starts at the clock it ran at last boot.
+  @param[in]  Private  SD card private data
+  @param[out] Done     TRUE if no ladder steps are left to try
+  @return EFI_UNSUPPORTED if the card is slower than the lowest step
+**/
+EFI_STATUS
+EFIAPI
+SdCardStartTrainClockSpi (
+  IN  SD_CARD_PRIVATE_DATA  *Private,
+  OUT BOOLEAN               *Done
+  )
+{
+  SD_CARD_SPI_CLOCK_MONITOR *Monitor;
+  EFI_STATUS                Status;
+
+  *Done = TRUE;
+  if (Private->WarmBoot.Hit) {
+    return SdCardRestoreClockSpi(Private, Private->WarmBoot.Cached.ClockHz);
+  }
+
+  Monitor = &Private->SpiClock;
+  Status = SdCardResetClockMonitorSpi(Private);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  Status = SdCardSetClockStepSpi(Private, 0);
+  if (!EFI_ERROR(Status)) {
+    Status = SdCardReadTrainingBlockSpi(Private, Monitor->Reference);
+  }
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  if (Monitor->CeilingIndex == 0) {
+    return SdCardEndTrainClockSpi(Private);
+  }
+
+  *Done = FALSE;
+  return EFI_SUCCESS;
+}
+
+/**
+  Tries the next step up the clock ladder. The reference block is read
+  SD_CARD_SPI_TRAINING_READS times and must pass its CRC16 and match. Once a
+  step fails or the card's rated maximum is reached, the data phase starts at
+  the last step that passed.
+  @param[in]  Private  SD card private data
+  @param[out] Done     TRUE once training has finished
+**/
+EFI_STATUS
+EFIAPI
+SdCardTrainClockStepSpi (
+  IN  SD_CARD_PRIVATE_DATA  *Private,
+  OUT BOOLEAN               *Done
+  )
+{
+  SD_CARD_SPI_CLOCK_MONITOR *Monitor;
+  UINT8                     Sample[SD_BLOCK_SIZE];
+  UINT32                    Step;
+  UINTN                     Read;
+  EFI_STATUS                Status;
+
+  Monitor = &Private->SpiClock;
+  Step = Monitor->BestIndex + 1;
+  Status = SdCardSetClockStepSpi(Private, Step);
+  for (Read = 0; !EFI_ERROR(Status) && Read < SD_CARD_SPI_TRAINING_READS; Read++) {
+    Status = SdCardReadTrainingBlockSpi(Private, Sample);
+    if (!EFI_ERROR(Status) && CompareMem(Sample, Monitor->Reference, SD_BLOCK_SIZE) != 0) {
+      Status = EFI_CRC_ERROR;
+    }
+  }
+
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_INFO, "SDCard: Clock training stopped at %u Hz: %r\n", Private->CurrentClockHz, Status));
+  } else {
+    Monitor->BestIndex = Step;
+    if (Step < Monitor->CeilingIndex) {
+      *Done = FALSE;
+      return EFI_SUCCESS;
+    }
+  }
+
+  *Done = TRUE;
+  return SdCardEndTrainClockSpi(Private);
+}
+
+/**
+  Feeds one transfer result to the data clock monitor.
+
+  A burst of CRC errors within the error window drops the clock one step;
+  a long enough run of clean transfers moves it one step back up.
+  @return TRUE if the clock was lowered
+**/
+BOOLEAN
+EFIAPI
+SdCardMonitorClockSpi (
+  IN SD_CARD_PRIVATE_DATA  *Private,
+  IN EFI_STATUS            TransferStatus
+  )
+{
+  SD_CARD_SPI_CLOCK_MONITOR *Monitor;
+
+  Monitor = &Private->SpiClock;
+  if (!Monitor->Trained) {
+    return FALSE;
+  }
+
+  if (TransferStatus == EFI_CRC_ERROR) {
+    Monitor->CleanCount = 0;
+    Monitor->ErrorCount++;
+    Monitor->WindowCount++;
+    if (Monitor->ErrorCount < SD_CARD_SPI_CRC_BURST || Monitor->StepIndex == 0) {
+      return FALSE;
+    }
+
+    // A step up that fails before proving itself makes the next try wait longer
+    if (Monitor->Probation) {
+      Monitor->UpshiftWindow = MIN(Monitor->UpshiftWindow * 2, SD_CARD_SPI_CLEAN_WINDOW_MAX);
+      Monitor->Probation = FALSE;
+    }
+    Monitor->ErrorCount = 0;
+    Monitor->WindowCount = 0;
+    SdCardSetClockStepSpi(Private, Monitor->StepIndex - 1);
+    DEBUG((DEBUG_WARN, "SDCard: CRC error burst, SPI clock lowered to %u Hz\n", Private->CurrentClockHz));
+    return TRUE;
+  }
+
+  if (EFI_ERROR(TransferStatus)) {
+    return FALSE;
+  }
+
+  if (++Monitor->WindowCount >= SD_CARD_SPI_CRC_WINDOW) {
+    Monitor->WindowCount = 0;
+    Monitor->ErrorCount = 0;
+  }
+
+  if (++Monitor->CleanCount < Monitor->UpshiftWindow) {
+    return FALSE;
+  }
+
+  Monitor->CleanCount = 0;
+  if (Monitor->Probation) {
+    // The previous step up held for a full window
+    Monitor->Probation = FALSE;
+    Monitor->UpshiftWindow = SD_CARD_SPI_CLEAN_WINDOW;
+  }
+  if (Monitor->StepIndex < Monitor->CeilingIndex) {
+    SdCardSetClockStepSpi(Private, Monitor->StepIndex + 1);
+    Monitor->Probation = TRUE;
+    DEBUG((DEBUG_INFO, "SDCard: Clean window, SPI clock raised to %u Hz\n", Private->CurrentClockHz));
+  }
+
+  return FALSE;
+}
+
+// =============================================================================
+// Internal SPI Helper Functions
+// =============================================================================
+
+//
+// SPI response format of each command that does not answer with a plain R1.
+// Application commands share the table; none of them clashes with the
+// standard command of the same index.
+//
+STATIC CONST SD_CARD_SPI_COMMAND_INFO mSdCardSpiCommandInfo[] = {
+  { CMD8,   SdCardSpiR7  },
+  { CMD12,  SdCardSpiR1b },
+  { CMD13,  SdCardSpiR2  },  // Also ACMD13 SD_STATUS
+  { CMD38,  SdCardSpiR1b },
+  { CMD58,  SdCardSpiR3  }
+};
+
+/**
+  Returns the number of response bytes that follow R1 for a command.
+**/
+STATIC
+UINTN
+SdCardSpiTrailingBytes (
+  IN  UINT8     Command,
+  OUT BOOLEAN   *Busy
+  )
+{
+  UINTN Index;
+
+  *Busy = FALSE;
+  for (Index = 0; Index < ARRAY_SIZE(mSdCardSpiCommandInfo); Index++) {
+    if (mSdCardSpiCommandInfo[Index].Command != Command) {
+      continue;
+    }
+    switch (mSdCardSpiCommandInfo[Index].ResponseType) {
+      case SdCardSpiR1b:
+        *Busy = TRUE;
+        return 0;
+      case SdCardSpiR2:
+        return 1;
+      case SdCardSpiR3:
+      case SdCardSpiR7:
+        return 4;
+      default:
+        return 0;
+    }
+  }
+
+  return 0;
+}
+
+//
+// Commands whose frames are kept in Private->SpiFrames, one slot each
+//
+STATIC CONST UINT8 mSdCardSpiFrameCommands[SD_CARD_SPI_FRAME_CACHE_SIZE] = {
+  CMD0, CMD8, CMD12, CMD13, CMD55
+};
+
+/**
+  Builds the 6-byte frame for a command. Frames of the commands in
+  mSdCardSpiFrameCommands are copied from the cache while the argument
+  matches and rebuilt into it when it does not.
+  @param[out] Frame  Receives the frame
+**/
+STATIC
+VOID
+SdCardBuildFrameSpi (
+  IN  SD_CARD_PRIVATE_DATA  *Private,
+  IN  UINT8                 Command,
+  IN  UINT32                Argument,
+  OUT UINT8                 *Frame
+  )
+{
+  SD_CARD_SPI_FRAME *Cached;
+  UINTN Index;
+
+  Cached = NULL;
+  for (Index = 0; Index < SD_CARD_SPI_FRAME_CACHE_SIZE; Index++) {
+    if (mSdCardSpiFrameCommands[Index] == Command) {
+      Cached = &Private->SpiFrames[Index];
+      break;
+    }
+  }
+
+  if (Cached != NULL && Cached->Valid && Cached->Argument == Argument) {
+    CopyMem(Frame, Cached->Frame, sizeof(Cached->Frame));
+    return;
   }
 
-  return Status;
+  SdCardPackCommand(Command, Argument, 0, Frame);
+  Frame[5] = SdCardCalculateCrc7(Frame, 5);
+
+  if (Cached != NULL) {
+    Cached->Argument = Argument;
+    CopyMem(Cached->Frame, Frame, sizeof(Cached->Frame));
+    Cached->Valid = TRUE;
+  }
 }
+
 /**
-  Initializes the SD card in SPI mode.
+  Sends a command frame and returns its R1 and any trailing response bytes
+  from the same transaction.
+
+  The transaction is a lead byte, the 6-byte frame, SD_CARD_SPI_NCR_MAX
+  bytes to find R1 in, and room for the bytes that follow R1 in this
+  command's response format. The card is only polled for busy beforehand
+  when it may still be busy from a write or an R1b command. Otherwise the
+  lead byte doubles as the busy check, and if it shows busy after all the
+  command is sent again once the card is ready.
+
+  After an R1b response the card is marked as possibly busy; the caller may
+  wait it out, or leave that to the next command.
+  @param[out] Trailing  Receives the bytes after R1 (R2, R3 or R7); optional
 **/
 EFI_STATUS
 EFIAPI
-SdCardInitializeSpi (
-  IN SD_CARD_PRIVATE_DATA   *Private
+SdCardSendCommandExSpi (
+  IN  SD_CARD_PRIVATE_DATA  *Private,
+  IN  UINT8                 Command,
+  IN  UINT32                Argument,
+  OUT UINT8                 *Response,
+  OUT UINT8                 *Trailing OPTIONAL
   )
 {
+  UINT8 WriteBuffer[1 + 6 + SD_CARD_SPI_NCR_MAX + 4];
+  UINT8 ReadBuffer[sizeof(WriteBuffer)];
+  UINTN Length;
+  UINTN TrailingBytes;
+  UINTN Available;
+  UINTN Index;
+  UINTN Attempt;
+  BOOLEAN Busy;
+  BOOLEAN CheckLead;
   EFI_STATUS Status;
-  UINT8      Response;
-  UINT8      Ocr[4];
-  UINTN      Retry;
-  UINT8      Csd[CSD_REGISTER_SIZE];
-
-  Private->IsInitialized = FALSE;
-  Private->BlockMedia.MediaPresent = FALSE;
-
-// Add to SdCardInitializeSpi() before CMD0
-// Send 80+ dummy clocks with CS deasserted and DI/MOSI high
-UINT8 dummyClocks[10];
-SetMem(dummyClocks, sizeof(dummyClocks), 0xFF);
-SpiDeassertCs(Private);
-SpiTransferBuffer(Private, dummyClocks, NULL, sizeof(dummyClocks));
-SpiAssertCs(Private);
-
-  // CMD0: Reset card to SPI mode
-  Status = SdCardSendCommandSpi(Private, CMD0, 0, &Response);
-  if (EFI_ERROR(Status) || Response != R1_IDLE_STATE) {
-    DEBUG((DEBUG_ERROR, "SDCard: CMD0 failed. Response: 0x%x, Status: %r\n", Response, Status));
-    return EFI_DEVICE_ERROR;
-  }
 
-  // CMD8: Check voltage range and pattern
-  Status = SdCardSendCommandSpi(Private, CMD8, CMD8_ARG_V2, &Response);
-  if (Status == EFI_SUCCESS && (Response & R1_IDLE_STATE)) {
-    Private->CardType = CARD_TYPE_SD_V2_SC;
-    SpiTransferBuffer(Private, NULL, Ocr, 4);
-    if (Ocr[3] != CMD8_CHECK_PATTERN) {
-      DEBUG((DEBUG_ERROR, "SDCard: CMD8 check pattern mismatch\n"));
-      return EFI_DEVICE_ERROR;
-    }
-  } else {
-    // For v1 cards or non-responsive cards, set to v1
-    Private->CardType = CARD_TYPE_SD_V1;
+  // Any other command ends an open read stream first
+  if (Command != CMD12 && Private->SpiStream.Open) {
+    SdCardCloseStreamSpi(Private);
   }
 
-  // ACMD41 initialize
-  Retry = 100;
-  do {
-    // send CMD55
-    Status = SdCardSendCommandSpi(Private, CMD55, 0, &Response);
-    if (EFI_ERROR(Status) || (Response & R1_ILLEGAL_COMMAND)) {
-      // If CMD55 fails or is illegal, try direct ACMD41 (some cards might not support CMD55)
-      Status = SdCardSendCommandSpi(Private, ACMD41, 0, &Response);
-    } else {
-      // ACMD41 with HCS if v2
-      UINT32 Arg = (Private->CardType == CARD_TYPE_SD_V2_SC) ? ACMD41_ARG_HCS : 0;
-      Status = SdCardSendCommandSpi(Private, ACMD41, Arg, &Response);
-    }
-    
-    if (EFI_ERROR(Status)) break;
+  // CMD0 may meet a card in any state, and CMD12 interrupts a data stream
+  // that would look like busy
+  CheckLead = (BOOLEAN)(Command != CMD0 && Command != CMD12);
 
-    if ((Response & R1_IDLE_STATE) == 0) {
-      break; // initialization complete
+  // A write or R1b command left behind reports its failure here
+  if (CheckLead) {
+    Status = SdCardFinishWriteSpi(Private);
+    if (EFI_ERROR(Status)) {
+      return Status;
     }
+  }
 
-    gBS->Stall(10000);
-    Retry--;
-  } while (Retry > 0);
+  TrailingBytes = SdCardSpiTrailingBytes(Command, &Busy);
+  Length = 1 + 6 + SD_CARD_SPI_NCR_MAX + TrailingBytes;
 
-  if (Retry == 0 || EFI_ERROR(Status)) {
-    DEBUG((DEBUG_ERROR, "SDCard: Initialization timeout or error. Response: 0x%x\n", Response));
-    return EFI_TIMEOUT;
-  }
+  WriteBuffer[0] = 0xFF;
+  SdCardBuildFrameSpi(Private, Command, Argument, &WriteBuffer[1]);
+  SetMem(WriteBuffer + 7, Length - 7, 0xFF);
 
-  // CMD58: Read OCR and detect CCS for HC
-  if (Private->CardType == CARD_TYPE_SD_V2_SC) {
-    Status = SdCardSendCommandSpi(Private, CMD58, 0, &Response);
-    if (EFI_ERROR(Status) || (Response != 0 && Response != R1_IDLE_STATE)) {
-      DEBUG((DEBUG_ERROR, "SDCard: CMD58 failed\n"));
-      return EFI_DEVICE_ERROR;
+  // One full-duplex transaction keeps Chip Select asserted from the frame
+  // through the response, as required by the spec
+  for (Attempt = 0; ; Attempt++) {
+    Status = SpiTransferBuffer(Private, WriteBuffer, ReadBuffer, Length);
+    if (EFI_ERROR(Status)) {
+      return Status;
+    }
+    if (!CheckLead || ReadBuffer[0] == 0xFF || Attempt > 0) {
+      break;
     }
-    SpiTransferBuffer(Private, NULL, Ocr, 4);
-    if (Ocr[0] & OCR_CCS_BIT) {
-      Private->CardType = CARD_TYPE_SD_V2_HC;
+
+    DEBUG((DEBUG_VERBOSE, "SdCardSendCommandSpi: Card busy before CMD%d, resending\n", Command));
+    Private->SpiWrite.BusyPending = TRUE;
+    Status = SdCardFinishWriteSpi(Private);
+    if (EFI_ERROR(Status)) {
+      return Status;
     }
   }
 
-  // CMD16: set block length for standard capacity
-  if (Private->CardType != CARD_TYPE_SD_V2_HC) {
-    Status = SdCardSendCommandSpi(Private, CMD16, SD_BLOCK_SIZE, &Response);
-    if (EFI_ERROR(Status) || (Response != 0)) {
-      DEBUG((DEBUG_ERROR, "SDCard: CMD16 failed\n"));
-      return EFI_DEVICE_ERROR;
+  // R1 is the first byte after the frame with the top bit clear. CMD12 is
+  // followed by a stuff byte that may still carry stream data.
+  for (Index = 7 + ((Command == CMD12) ? 1 : 0); Index < 7 + SD_CARD_SPI_NCR_MAX; Index++) {
+    if ((ReadBuffer[Index] & 0x80) == 0) {
+      break;
     }
   }
+  if (Index == 7 + SD_CARD_SPI_NCR_MAX) {
+    DEBUG((DEBUG_ERROR, "SdCardSendCommandSpi: Timeout waiting for response to CMD%d\n", Command));
+    return EFI_TIMEOUT;
+  }
 
-  // CMD9: read CSD
-  Status = SdCardSendCommandSpi(Private, CMD9, 0, &Response);
-  if (EFI_ERROR(Status) || (Response != 0 && Response != R1_IDLE_STATE)) {
-    DEBUG((DEBUG_ERROR, "SDCard: CMD9 failed\n"));
-    return EFI_DEVICE_ERROR;
+  *Response = ReadBuffer[Index];
+  if (Busy) {
+    Private->SpiWrite.BusyPending = TRUE;
   }
 
-  Status = SdCardReadDataBlockSpi(Private, CSD_REGISTER_SIZE, Csd);
-  if (EFI_ERROR(Status)) {
-    DEBUG((DEBUG_ERROR, "SDCard: Failed to read CSD\n"));
-    return Status;
+  if ((*Response & R1_COM_CRC_ERROR) != 0) {
+    DEBUG((DEBUG_WARN, "SdCardSendCommandSpi: CRC indicated in response for CMD%d\n", Command));
+    return EFI_CRC_ERROR;
+  }
+  if ((*Response & R1_ILLEGAL_COMMAND) != 0) {
+    DEBUG((DEBUG_WARN, "SdCardSendCommandSpi: Illegal command error for CMD%d\n", Command));
+    return EFI_UNSUPPORTED;
   }
 
-  // Use the SPI-specific CSD parser instead of the generic one
-  Status = SdCardParseCsdSpi(Private, Csd);
-  if (EFI_ERROR(Status)) {
-    DEBUG((DEBUG_ERROR, "Failed to parse CSD register: %r\n", Status));
-    return Status;
+  // The rest of the response is in the buffer unless R1 came late
+  if (TrailingBytes != 0) {
+    Available = MIN(TrailingBytes, Length - Index - 1);
+    if (Trailing != NULL) {
+      CopyMem(Trailing, &ReadBuffer[Index + 1], Available);
+    }
+    if (Available < TrailingBytes) {
+      Status = SpiTransferBuffer(Private, NULL, ReadBuffer, TrailingBytes - Available);
+      if (EFI_ERROR(Status)) {
+        return Status;
+      }
+      if (Trailing != NULL) {
+        CopyMem(Trailing + Available, ReadBuffer, TrailingBytes - Available);
+      }
+    }
   }
 
-  DEBUG((DEBUG_INFO, "SDCard: Initialized successfully. CardType: %d, LastBlock: %llu\n",
-         Private->CardType, Private->LastBlock));
   return EFI_SUCCESS;
 }
 
-
-
-// =============================================================================
-// Internal SPI Helper Functions
-// =============================================================================
-
 /**
-  Sends a 6-byte command frame to the SD card over SPI with proper CRC calculation.
+  Sends a command and returns its R1. Trailing response bytes are consumed.
 **/
 EFI_STATUS
 EFIAPI
@@ -228,69 +1884,99 @@ SdCardSendCommandSpi (
   OUT UINT8                 *Response
   )
 {
-  UINT8 CommandFrame[6];
-  UINT8 WriteBuffer[14]; // 6 for command, 8 for response polling
-  UINT8 ReadBuffer[14];
-  UINT8 Crc;
-  UINTN Index;
-  EFI_STATUS Status;
-
-  // Wait for card to be ready (except for CMD0)
-  if (Command != CMD0) {
-    (void)SdCardWaitNotBusySpi(Private);
-  }
+  return SdCardSendCommandExSpi(Private, Command, Argument, Response, NULL);
+}
 
-  // Construct command frame
-  CommandFrame[0] = (UINT8)(0x40 | (Command & 0x3F));
-  CommandFrame[1] = (UINT8)(Argument >> 24);
-  CommandFrame[2] = (UINT8)(Argument >> 16);
-  CommandFrame[3] = (UINT8)(Argument >> 8);
-  CommandFrame[4] = (UINT8)(Argument & 0xFF);
+/**
+  Polls the card until it releases busy or starts sending a token.
 
-  // Calculate proper CRC7 for all commands
-  Crc = SdCardCalculateCrc7(CommandFrame, 5);
-  CommandFrame[5] = Crc;
+  Each transaction reads a burst of bytes. A miss doubles the next burst, up
+  to MaxBurst, and the stall before it, up to SD_CARD_SPI_POLL_STALL_MAX_US.
+  The card only moves on while it is clocked, so no data is lost between
+  bursts. Long write busy waits are kept out of requests by the busy check
+  timer; a TimeoutUs of 0 reads one burst and returns.
 
-  // Construct a single transaction buffer: 6-byte command + 8 dummy bytes for response
-  CopyMem(WriteBuffer, CommandFrame, sizeof(CommandFrame));
-  SetMem(WriteBuffer + sizeof(CommandFrame), 8, 0xFF);
+  Busy is over when the last byte of a burst is 0xFF. A token has arrived
+  when any byte of a burst is not 0xFF; the caller finds it in Buffer.
+  @param[in]  WaitForToken  TRUE to wait for a token, FALSE to wait out busy
+  @param[in]  TimeoutUs     Time to give up after
+  @param[in]  Burst         Bytes to read in the first transaction
+  @param[in]  MaxBurst      Largest burst; Buffer must hold this many bytes
+  @param[out] Buffer        Receives the bytes of the last burst
+  @param[out] Received      Length of the last burst
+  @param[out] Scanned       Bytes clocked before the last burst
+**/
+STATIC
+EFI_STATUS
+SdCardPollSpi (
+  IN  SD_CARD_PRIVATE_DATA  *Private,
+  IN  BOOLEAN               WaitForToken,
+  IN  UINT32                TimeoutUs,
+  IN  UINTN                 Burst,
+  IN  UINTN                 MaxBurst,
+  OUT UINT8                 *Buffer,
+  OUT UINTN                 *Received,
+  OUT UINTN                 *Scanned OPTIONAL
+  )
+{
+  EFI_STATUS Status;
+  UINT64     StartNs;
+  UINT64     ElapsedNs;
+  UINTN      Clocked;
+  UINTN      Index;
+  UINTN      StallUs;
 
-  // Perform a single, full-duplex transaction to send the command and poll for the response.
-  // This ensures Chip Select remains asserted for the entire operation, as required by the spec.
-  Status = SpiTransferBuffer(Private, WriteBuffer, ReadBuffer, sizeof(WriteBuffer));
-  if (EFI_ERROR(Status)) {
-    return Status;
-  }
+  StartNs    = GetTimeInNanoSecond(GetPerformanceCounter());
+  Clocked    = 0;
+  StallUs    = 1;
+  Burst      = MIN(MAX(Burst, 1), MaxBurst);
 
-  // Find the response in the read buffer. It's the first byte after the command
-  // that is not 0xFF.
-  for (Index = sizeof(CommandFrame); Index < sizeof(ReadBuffer); Index++) {
-    if (Index >= sizeof(ReadBuffer)) { 
-      DEBUG((DEBUG_ERROR, "Response buffer overflow in CMD%d\n", Command)); 
-      return EFI_BUFFER_TOO_SMALL; 
+  for (;;) {
+    Status = SpiTransferBuffer(Private, NULL, Buffer, Burst);
+    if (EFI_ERROR(Status)) {
+      break;
     }
-    if ((ReadBuffer[Index] & 0x80) == 0) {
-      *Response = ReadBuffer[Index];
 
-      if ((*Response & R1_COM_CRC_ERROR) != 0) {
-        DEBUG((DEBUG_WARN, "SdCardSendCommandSpi: CRC indicated in response for CMD%d\n", Command));
-        return EFI_CRC_ERROR;
+    if (WaitForToken) {
+      for (Index = 0; Index < Burst && Buffer[Index] == 0xFF; Index++) {
       }
-      if ((*Response & R1_ILLEGAL_COMMAND) != 0) {
-        DEBUG((DEBUG_WARN, "SdCardSendCommandSpi: Illegal command error for CMD%d\n", Command));
-        return EFI_UNSUPPORTED;
+      if (Index < Burst) {
+        break;
       }
+    } else if (Buffer[Burst - 1] == 0xFF) {
+      break;
+    }
 
-      return EFI_SUCCESS;
+    ElapsedNs = GetTimeInNanoSecond(GetPerformanceCounter()) - StartNs;
+    if (ElapsedNs >= (UINT64)TimeoutUs * 1000) {
+      Status = EFI_TIMEOUT;
+      break;
     }
+
+    Clocked += Burst;
+    Burst    = MIN(Burst * 2, MaxBurst);
+
+    gBS->Stall(StallUs);
+    StallUs = MIN(StallUs * 2, SD_CARD_SPI_POLL_STALL_MAX_US);
   }
 
-  DEBUG((DEBUG_ERROR, "SdCardSendCommandSpi: Timeout waiting for response to CMD%d\n", Command));
-  return EFI_TIMEOUT;
+  // A busy wait that ran out leaves the card possibly still busy
+  if (!WaitForToken) {
+    Private->SpiWrite.BusyPending = (BOOLEAN)EFI_ERROR(Status);
+  }
+
+  *Received = Burst;
+  if (Scanned != NULL) {
+    *Scanned = Clocked;
+  }
+  return Status;
 }
 
 /**
   Waits for the card to be not busy (DO/MISO line is high) in SPI mode.
+
+  The wait is bounded by the card's write timeout, the longest busy it may
+  signal.
 **/
 EFI_STATUS
 EFIAPI
@@ -298,19 +1984,12 @@ SdCardWaitNotBusySpi (
   IN  SD_CARD_PRIVATE_DATA  *Private
   )
 {
-  UINTN Retry = 5000; // ~500ms depending on stall granularity
-  UINT8 BusyByte;
-
-  do {
-    SpiTransferBuffer (Private, NULL, &BusyByte, 1);
-    if (BusyByte == 0xFF) {
-      return EFI_SUCCESS;
-    }
-    gBS->Stall (1);
-    Retry--;
-  } while (Retry > 0);
+  UINT8 Burst[SD_CARD_SPI_POLL_BURST_MAX];
+  UINTN Received;
+  UINT32 TimeoutUs;
 
-  return EFI_TIMEOUT;
+  TimeoutUs = (Private->SpiWrite.BusyTimeoutUs != 0) ? Private->SpiWrite.BusyTimeoutUs : WRITE_TIMEOUT_US;
+  return SdCardPollSpi(Private, FALSE, TimeoutUs, 1, sizeof(Burst), Burst, &Received, NULL);
 }
 
 /**
@@ -349,12 +2028,75 @@ SdCardParseCsdSpi(
   Private->LastBlock = (Capacity / SD_BLOCK_SIZE) - 1;
   Private->BlockMedia.BlockSize = Private->BlockSize;
   Private->BlockMedia.LastBlock = Private->LastBlock;
+  CopyMem(Private->Csd, Csd, sizeof(Private->Csd));
+  ZeroMem(&Private->SpiNac, sizeof(Private->SpiNac));
+
+  // Read timeout is 100 times TAAC for standard capacity cards and fixed
+  // otherwise; the write timeout scales it by R2W_FACTOR (CSD bits [28:26])
+  if ((Csd[0] & 0xC0) == 0x40) {
+    Private->SpiNac.ReadTimeoutUs = SD_READ_TIMEOUT_US;
+    Private->SpiWrite.BusyTimeoutUs = (Capacity > SIZE_32GB) ? SDXC_WRITE_TIMEOUT_US : SD_WRITE_TIMEOUT_US;
+  } else {
+    Private->SpiNac.ReadTimeoutUs = MIN(SdCardDecodeTaac(Csd[1]) / 10, SD_READ_TIMEOUT_US);
+    Private->SpiNac.ReadTimeoutUs = MAX(Private->SpiNac.ReadTimeoutUs, 1000);
+    Private->SpiWrite.BusyTimeoutUs = MIN(Private->SpiNac.ReadTimeoutUs << ((Csd[12] >> 2) & 0x07), SD_WRITE_TIMEOUT_US);
+  }
+  Private->SpiNac.ReadTimeoutUs = MIN(Private->SpiNac.ReadTimeoutUs, READ_TIMEOUT_US);
+  Private->SpiWrite.BusyTimeoutUs = MIN(Private->SpiWrite.BusyTimeoutUs, WRITE_TIMEOUT_US);
+
+  // TRAN_SPEED (CSD byte 3) is the card's maximum data clock
+  Private->MaxClockHz = SdCardDecodeTranSpeed(Csd[3]);
+  if (Private->MaxClockHz == 0) {
+    Private->MaxClockHz = SPI_MAX_CLOCK_HZ;
+  }
 
   return EFI_SUCCESS;
 }
 
+/**
+  Refreshes the NAC prediction when the CSD or the SPI clock has changed.
+
+  The read access time is TAAC plus 100 * NSAC clocks. TAAC scales with the
+  clock, so the byte counts are recomputed for every clock change, and the
+  learned average offset is scaled along with them.
+**/
+STATIC
+VOID
+SdCardUpdateNacSpi (
+  IN SD_CARD_PRIVATE_DATA  *Private
+  )
+{
+  SD_CARD_SPI_NAC *Nac;
+  UINT64          Clocks;
+  UINT32          ClockHz;
+
+  Nac     = &Private->SpiNac;
+  ClockHz = (Private->CurrentClockHz != 0) ? Private->CurrentClockHz : SPI_INIT_CLOCK_HZ;
+  if (Nac->ClockHz == ClockHz) {
+    return;
+  }
+
+  Clocks = DivU64x32(MultU64x32(SdCardDecodeTaac(Private->Csd[1]), ClockHz), 1000000000) +
+           100 * (UINT64)Private->Csd[2];
+  Nac->PredictedBytes = (UINT32)MIN(Clocks / 8, MAX_UINT32);
+  Nac->TimeoutBytes   = (UINT32)DivU64x32(MultU64x32((Nac->ReadTimeoutUs != 0) ? Nac->ReadTimeoutUs : READ_TIMEOUT_US, ClockHz), 8 * 1000000);
+
+  if (Nac->ClockHz != 0 && Nac->AverageOffset4 != 0) {
+    Nac->AverageOffset4 = (UINT32)MIN(DivU64x32(MultU64x32(Nac->AverageOffset4, ClockHz), Nac->ClockHz), MAX_UINT32);
+  } else {
+    Nac->AverageOffset4 = (UINT32)MIN((UINT64)Nac->PredictedBytes * 4, MAX_UINT32);
+  }
+  Nac->ClockHz = ClockHz;
+}
+
 /**
   Reads a data block from the card in SPI mode with CRC verification.
+
+  The start token is searched for in windows sized from the predicted read
+  access time, each read in one transaction, through the shared poller.
+  Bytes that follow the token in the window are the start of the payload.
+  The window never reaches past the end of the block, so a following block
+  in a multi-block read is untouched.
 **/
 EFI_STATUS
 EFIAPI
@@ -364,82 +2106,346 @@ SdCardReadDataBlockSpi (
   OUT UINT8                 *Buffer
   )
 {
-  UINTN Retry = 200000; // loop count — tuned by caller
-  UINT8 Token;
+  SD_CARD_SPI_NAC *Nac;
+  UINT8 Window[SD_BLOCK_SIZE + 3];
+  UINTN WindowSize;
+  UINTN Scanned;
+  UINTN Index;
+  UINTN Tail;
+  UINTN Copied;
+  UINT32 Average;
   UINT16 ReceivedCrc, CalculatedCrc;
+  UINT8 CrcBytes[2];
+  EFI_STATUS Status;
 
-  do {
-    SpiTransferBuffer(Private, NULL, &Token, 1);
-    if (Token == DATA_TOKEN_READ_START) {
-      // Read data payload
-      SpiTransferBuffer(Private, NULL, Buffer, Length);
-
-      // Read received CRC (big-endian on bus)
-      UINT8 CrcBytes[2];
-      SpiTransferBuffer(Private, NULL, CrcBytes, 2);
-      ReceivedCrc = (UINT16)((CrcBytes[0] << 8) | CrcBytes[1]);
-
-      // Calculate CRC and compare
-      CalculatedCrc = SdCardCalculateCrc16(Buffer, Length);;
-      if (ReceivedCrc != CalculatedCrc) {
-        DEBUG((DEBUG_ERROR, "SdCardReadDataBlockSpi: CRC mismatch! Received: 0x%04X, Calculated: 0x%04X\n",
-               ReceivedCrc, CalculatedCrc));
-        return EFI_CRC_ERROR;
-      }
+  Nac = &Private->SpiNac;
+  SdCardUpdateNacSpi(Private);
 
-      return EFI_SUCCESS;
+  Average = Nac->AverageOffset4 / 4;
+  WindowSize = (UINTN)Average + Average / 2 + SD_CARD_SPI_TOKEN_WINDOW_MARGIN;
+  WindowSize = MAX(WindowSize, SD_CARD_SPI_TOKEN_WINDOW_MIN);
+  WindowSize = MIN(WindowSize, MIN(Length + 3, sizeof(Window)));
+
+  // The window grows while the token is late, but never past the block
+  Status = SdCardPollSpi(
+             Private,
+             TRUE,
+             (Nac->ReadTimeoutUs != 0) ? Nac->ReadTimeoutUs : READ_TIMEOUT_US,
+             WindowSize,
+             MIN(Length + 3, sizeof(Window)),
+             Window,
+             &WindowSize,
+             &Scanned
+             );
+  if (Status == EFI_TIMEOUT) {
+    DEBUG((DEBUG_ERROR, "SdCardReadDataBlockSpi: Timeout waiting for data token\n"));
+  }
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  for (Index = 0; Window[Index] == 0xFF; Index++) {
+  }
+
+  if (Window[Index] != DATA_TOKEN_READ_START) {
+    if ((Window[Index] & DATA_ERROR_TOKEN_MASK) == 0) {
+      DEBUG((DEBUG_ERROR, "SdCardReadDataBlockSpi: Data error token 0x%02X\n", Window[Index]));
+      return EFI_DEVICE_ERROR;
+    }
+    DEBUG((DEBUG_ERROR, "SdCardReadDataBlockSpi: Unexpected token 0x%02X\n", Window[Index]));
+    return EFI_DEVICE_ERROR;
+  }
+
+  Nac->AverageOffset4 += (UINT32)(Scanned + Index) - Nac->AverageOffset4 / 4;
+
+  // Bytes after the token are payload, then CRC (big-endian on bus). The
+  // payload CRC is computed as the bytes are copied out.
+  Tail   = WindowSize - Index - 1;
+  Copied = MIN(Tail, Length);
+  CalculatedCrc = SdCardCopyCrc16(0, Buffer, &Window[Index + 1], Copied);
+  CopyMem(CrcBytes, &Window[Index + 1 + Copied], Tail - Copied);
+
+  // The rest of the payload and CRC go in one transaction
+  Status = EFI_SUCCESS;
+  if (Copied < Length) {
+    Status = SpiBatchQueueCrc16(Private, NULL, Buffer + Copied, Length - Copied, &CalculatedCrc);
+  }
+  if (!EFI_ERROR(Status) && Tail - Copied < sizeof(CrcBytes)) {
+    Status = SpiBatchQueue(Private, NULL, CrcBytes + (Tail - Copied), sizeof(CrcBytes) - (Tail - Copied));
+  }
+  if (EFI_ERROR(Status)) {
+    SpiBatchDiscard(Private);
+    return Status;
+  }
+  Status = SpiBatchFlush(Private);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  ReceivedCrc = (UINT16)((CrcBytes[0] << 8) | CrcBytes[1]);
+
+  if (ReceivedCrc != CalculatedCrc) {
+    DEBUG((DEBUG_ERROR, "SdCardReadDataBlockSpi: CRC mismatch! Received: 0x%04X, Calculated: 0x%04X\n",
+           ReceivedCrc, CalculatedCrc));
+    return EFI_CRC_ERROR;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Parses one received chunk of a CMD18 data stream.
+
+  Payload bytes are copied straight into the caller's buffer, folding them
+  into the block's CRC16 on the way, and the CRC16 is checked as soon as its
+  last CRC byte arrives.
+**/
+STATIC
+EFI_STATUS
+SdCardParseStreamSpi (
+  IN SD_CARD_PRIVATE_DATA  *Private,
+  IN CONST UINT8           *Data,
+  IN UINTN                 Length
+  )
+{
+  SD_CARD_SPI_STREAM *Stream;
+  UINTN              Index;
+  UINTN              Count;
+  UINT16             ReceivedCrc;
+  UINT16             CalculatedCrc;
+
+  Stream = &Private->SpiStream;
+  Index  = 0;
+  while (Index < Length) {
+    switch (Stream->State) {
+      case SdCardSpiStreamGap:
+        while (Index < Length && Data[Index] == 0xFF) {
+          Index++;
+          Stream->GapBytes++;
+        }
+        if (Index == Length) {
+          if (Stream->GapBytes >= Private->SpiNac.TimeoutBytes) {
+            DEBUG((DEBUG_ERROR, "SdCardStreamReadSpi: Timeout waiting for data token\n"));
+            return EFI_TIMEOUT;
+          }
+          break;
+        }
+        if (Data[Index] != DATA_TOKEN_READ_START) {
+          DEBUG((DEBUG_ERROR, "SdCardStreamReadSpi: %a token 0x%02X\n",
+                 ((Data[Index] & DATA_ERROR_TOKEN_MASK) == 0) ? "Data error" : "Unexpected", Data[Index]));
+          return EFI_DEVICE_ERROR;
+        }
+        Private->SpiNac.AverageOffset4 += (UINT32)Stream->GapBytes - Private->SpiNac.AverageOffset4 / 4;
+        Index++;
+        Stream->State    = SdCardSpiStreamPayload;
+        Stream->Offset   = 0;
+        Stream->BlockCrc = 0;
+        Stream->GapBytes = 0;
+        break;
+
+      case SdCardSpiStreamPayload:
+        Count = MIN(SD_BLOCK_SIZE - Stream->Offset, Length - Index);
+        Stream->BlockCrc = SdCardCopyCrc16(Stream->BlockCrc, Stream->Block + Stream->Offset, Data + Index, Count);
+        Stream->Offset += Count;
+        Index          += Count;
+        if (Stream->Offset == SD_BLOCK_SIZE) {
+          Stream->State    = SdCardSpiStreamCrc;
+          Stream->CrcIndex = 0;
+        }
+        break;
+
+      case SdCardSpiStreamCrc:
+        Stream->Crc[Stream->CrcIndex++] = Data[Index++];
+        if (Stream->CrcIndex < sizeof(Stream->Crc)) {
+          break;
+        }
+        ReceivedCrc   = (UINT16)((Stream->Crc[0] << 8) | Stream->Crc[1]);
+        CalculatedCrc = Stream->BlockCrc;
+        if (ReceivedCrc != CalculatedCrc) {
+          DEBUG((DEBUG_ERROR, "SdCardStreamReadSpi: CRC mismatch in block %u! Received: 0x%04X, Calculated: 0x%04X\n",
+                 Stream->BlocksDone, ReceivedCrc, CalculatedCrc));
+          return EFI_CRC_ERROR;
+        }
+        Stream->BlocksDone++;
+        Stream->Block += SD_BLOCK_SIZE;
+        Stream->State  = SdCardSpiStreamGap;
+        break;
     }
-    gBS->Stall(1); // small delay
-    Retry--;
-  } while (Retry > 0);
+  }
 
-  DEBUG((DEBUG_ERROR, "SdCardReadDataBlockSpi: Timeout waiting for data token\n"));
-  return EFI_TIMEOUT;
+  return EFI_SUCCESS;
 }
 
 /**
-  Writes a data block to the card in SPI mode with proper CRC generation.
+  Receives the data blocks of a CMD18 read as a continuous stream.
+
+  The stream is clocked in transfers as large as the arena and controller
+  allow, each sized so that it never runs past the last requested block, and
+  parsed as it arrives. The caller sends CMD18 before and CMD12 after.
 **/
 EFI_STATUS
 EFIAPI
-SdCardWriteDataBlockSpi (
+SdCardStreamReadSpi (
+  IN  SD_CARD_PRIVATE_DATA  *Private,
+  IN  UINTN                 BlockCount,
+  OUT UINT8                 *Buffer
+  )
+{
+  SD_CARD_SPI_STREAM *Stream;
+  UINT8              *Chunk;
+  UINTN              ChunkLimit;
+  UINTN              Remaining;
+  EFI_STATUS         Status;
+
+  if (Private->SpiArena.ScratchBuffer == NULL) {
+    // No arena to stream through; fall back to block-at-a-time reads
+    for (; BlockCount > 0; BlockCount--, Buffer += SD_BLOCK_SIZE) {
+      Status = SdCardReadDataBlockSpi(Private, SD_BLOCK_SIZE, Buffer);
+      if (EFI_ERROR(Status)) {
+        return Status;
+      }
+    }
+    return EFI_SUCCESS;
+  }
+
+  SdCardUpdateNacSpi(Private);
+
+  // Parser state starts at a block boundary; an open stream is always
+  // left in the gap before its next token
+  Stream = &Private->SpiStream;
+  Stream->State      = SdCardSpiStreamGap;
+  Stream->Block      = Buffer;
+  Stream->Offset     = 0;
+  Stream->GapBytes   = 0;
+  Stream->CrcIndex   = 0;
+  Stream->BlocksDone = 0;
+
+  // The arena scratch region is free while no batch is pending
+  Chunk      = Private->SpiArena.ScratchBuffer;
+  ChunkLimit = MIN(Private->SpiArena.Size, Private->SpiPlanner.MaxTransferBytes);
+
+  while (Stream->BlocksDone < BlockCount) {
+    // Fewest bytes that can still belong to the requested blocks
+    Remaining = (BlockCount - Stream->BlocksDone - 1) * (1 + SD_BLOCK_SIZE + 2);
+    switch (Stream->State) {
+      case SdCardSpiStreamGap:
+        Remaining += 1 + SD_BLOCK_SIZE + 2;
+        break;
+      case SdCardSpiStreamPayload:
+        Remaining += SD_BLOCK_SIZE - Stream->Offset + 2;
+        break;
+      case SdCardSpiStreamCrc:
+        Remaining += sizeof(Stream->Crc) - Stream->CrcIndex;
+        break;
+    }
+
+    Remaining = MIN(Remaining, ChunkLimit);
+    Status = SpiTransferBuffer(Private, NULL, Chunk, Remaining);
+    if (EFI_ERROR(Status)) {
+      return Status;
+    }
+
+    Status = SdCardParseStreamSpi(Private, Chunk, Remaining);
+    if (EFI_ERROR(Status)) {
+      return Status;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Sends one data block. Without a precomputed CRC16 the CRC is computed
+  while the payload is copied into the batch.
+
+  Token, payload, CRC (big-endian on the bus), the data response byte and
+  SD_CARD_SPI_WRITE_BUSY_PROBE busy probe bytes go out as one transaction.
+  If the last probe byte shows the card already ready, no busy is left
+  pending and the next block can follow at once.
+**/
+STATIC
+EFI_STATUS
+SdCardSendDataBlockSpi (
   IN  SD_CARD_PRIVATE_DATA  *Private,
   IN  UINT8                 Token,
   IN  UINTN                 Length,
-  IN  CONST UINT8           *Buffer
+  IN  CONST UINT8           *Buffer,
+  IN  CONST UINT16          *Crc OPTIONAL
   )
 {
   EFI_STATUS Status;
+  UINT8 Trailer[1 + SD_CARD_SPI_WRITE_BUSY_PROBE];
+  UINT8 CrcBytes[2];
   UINT8 Response;
-  UINT16 Crc;
+  UINT16 BlockCrc;
 
-  // Calculate CRC for the data block
-  Crc = SdCardCalculateCrc16(Buffer, Length);
-
-  // Send data token
-  SpiTransferBuffer(Private, &Token, NULL, 1);
-
-  // Send data payload
-  SpiTransferBuffer(Private, (UINT8*)Buffer, NULL, Length);
+  // Within CMD25 the previous block must finish programming first
+  Status = SdCardFinishWriteSpi(Private);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
 
-  // Send CRC (big-endian on the bus)
-  UINT8 CrcBytes[2] = { (UINT8)(Crc >> 8), (UINT8)(Crc & 0xFF) };
-  SpiTransferBuffer(Private, CrcBytes, NULL, 2);
+  // A queue call that fails may already have sent part of the block; the
+  // rest is dropped so the trailer is never read from a partial transfer
+  Status = SpiBatchQueue(Private, &Token, NULL, 1);
+  if (!EFI_ERROR(Status)) {
+    if (Crc != NULL) {
+      BlockCrc = *Crc;
+      Status = SpiBatchQueue(Private, Buffer, NULL, Length);
+    } else {
+      BlockCrc = 0;
+      Status = SpiBatchQueueCrc16(Private, Buffer, NULL, Length, &BlockCrc);
+    }
+  }
+  if (!EFI_ERROR(Status)) {
+    CrcBytes[0] = (UINT8)(BlockCrc >> 8);
+    CrcBytes[1] = (UINT8)(BlockCrc & 0xFF);
+    Status = SpiBatchQueue(Private, CrcBytes, NULL, sizeof(CrcBytes));
+  }
+  if (!EFI_ERROR(Status)) {
+    Status = SpiBatchQueue(Private, NULL, Trailer, sizeof(Trailer));
+  }
+  if (EFI_ERROR(Status)) {
+    SpiBatchDiscard(Private);
+    return Status;
+  }
+  Status = SpiBatchFlush(Private);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
 
-  // Read data response token
-  SpiTransferBuffer(Private, NULL, &Response, 1);
+  Response = Trailer[0];
+  if ((Response & DATA_RESP_MASK) == DATA_RESP_CRC_ERROR) {
+    DEBUG((DEBUG_ERROR, "SdCardSendDataBlockSpi: Card reported a data CRC error\n"));
+    SdCardWaitNotBusySpi(Private);
+    return EFI_CRC_ERROR;
+  }
   if ((Response & DATA_RESP_MASK) != DATA_RESP_ACCEPTED) {
-    DEBUG((DEBUG_ERROR, "SdCardWriteDataBlockSpi: Data response error: 0x%02X\n", Response));
+    DEBUG((DEBUG_ERROR, "SdCardSendDataBlockSpi: Data response error: 0x%02X\n", Response));
+    Private->SpiWrite.BusyPending = TRUE;
     return EFI_DEVICE_ERROR;
   }
 
-  // Wait for write complete (card not busy)
-  Status = SdCardWaitNotBusySpi(Private);
-  if (EFI_ERROR(Status)) {
-    DEBUG((DEBUG_ERROR, "SdCardWriteDataBlockSpi: Write completion timeout\n"));
-  }
+  // The card programs the block while the caller moves on
+  Private->SpiWrite.BusyPending = (BOOLEAN)(Trailer[sizeof(Trailer) - 1] != 0xFF);
+  return EFI_SUCCESS;
+}
 
-  return Status;
+/**
+  Writes a data block to the card in SPI mode with proper CRC generation.
+
+  Returns as soon as the data response says the block was accepted; the
+  programming busy is left pending for SdCardFinishWriteSpi.
+**/
+EFI_STATUS
+EFIAPI
+SdCardWriteDataBlockSpi (
+  IN  SD_CARD_PRIVATE_DATA  *Private,
+  IN  UINT8                 Token,
+  IN  UINTN                 Length,
+  IN  CONST UINT8           *Buffer
+  )
+{
+  return SdCardSendDataBlockSpi(Private, Token, Length, Buffer, NULL);
 }
 
 /**
@@ -16,9 +16,12 @@
 #define CMD23   23  // SET_BLOCK_COUNT (for MMC)
 #define CMD24   24  // WRITE_BLOCK
 #define CMD25   25  // WRITE_MULTIPLE_BLOCK
+#define ACMD13  13  // SD_STATUS (for SD)
+#define ACMD22  22  // SEND_NUM_WR_BLOCKS (for SD)
 #define ACMD23  23  // SET_WR_BLOCK_ERASE_COUNT (for SD)
 
 #define ACMD41  41  // APP_SEND_OP_COND (for SD)
+#define ACMD51  51  // SEND_SCR (for SD)
 #define CMD55   55  // APP_CMD
 #define CMD58   58  // READ_OCR
 #define CMD59   59  // CRC_ON_OFF
@@ -44,6 +47,35 @@ SdCardCalculateCrc16 (
 #define CMD8_CHECK_PATTERN 0xAA     // Expected check pattern in R7 response
 #define ACMD41_ARG_HCS  0x40000000  // HCS bit for ACMD41
 
+// CMD6 SWITCH_FUNC: mode bit, and group 1 (access mode) function 1 (High Speed)
+// with every other group left unchanged
+#define CMD6_MODE_CHECK             0x00000000
+#define CMD6_MODE_SWITCH            0x80000000
+#define CMD6_ARG_GROUP1_HIGH_SPEED  0x00FFFFF1
+#define SD_SWITCH_STATUS_SIZE       64
+#define SD_CCC_SWITCH               BIT10       // Command class 10 (switch) in CSD CCC
+
+// ACMD22 returns the count of well-written blocks as a 4-byte data block
+#define SD_NUM_WR_BLOCKS_SIZE   4
+
+// ACMD23 takes the pre-erase block count in bits [22:0]
+#define ACMD23_MAX_BLOCK_COUNT  0x007FFFFF
+
+// SPI response formats. R1b is R1 followed by busy; R2 adds one status
+// byte, R3 the OCR and R7 the CMD8 echo.
+typedef enum {
+  SdCardSpiR1,
+  SdCardSpiR1b,
+  SdCardSpiR2,
+  SdCardSpiR3,
+  SdCardSpiR7
+} SD_CARD_SPI_RESPONSE_TYPE;
+
+typedef struct {
+  UINT8                      Command;
+  SD_CARD_SPI_RESPONSE_TYPE  ResponseType;
+} SD_CARD_SPI_COMMAND_INFO;
+
 // R1 Response Bits
 #define R1_RESPONSE_RECV        BIT7 // Top bit must be 0
 
@@ -74,6 +106,16 @@ SdCardCalculateCrc16 (
 // CID register size
 #define CID_REGISTER_SIZE       16
 
+// SCR register and SD Status sizes
+#define SCR_REGISTER_SIZE       8
+#define SD_STATUS_SIZE          64
+
+// SCR DATA_STAT_AFTER_ERASE (bit 55): erased blocks read as ones when set
+#define SCR_DATA_STAT_AFTER_ERASE  BIT7   // In SCR byte 1
+
+// Erase timeout per AU when the SD Status does not give one
+#define SD_ERASE_TIMEOUT_PER_AU_US 250000
+
 // Standard block size
 #define SD_BLOCK_SIZE           512
 
@@ -83,23 +125,100 @@ SdCardCalculateCrc16 (
 // Maximum SPI clock frequency during data transfer (up to 25 MHz for SD)
 #define SPI_MAX_CLOCK_HZ        25000000
 
+// Maximum SPI clock frequency once the card is in High Speed mode
+#define SPI_HIGH_SPEED_CLOCK_HZ 50000000
+
+// Data clock monitor: SD_CARD_SPI_CRC_BURST CRC errors within
+// SD_CARD_SPI_CRC_WINDOW transfers drop the clock one step, and
+// SD_CARD_SPI_CLEAN_WINDOW clean transfers allow one step back up. A step up
+// that fails before proving itself doubles the wait, up to
+// SD_CARD_SPI_CLEAN_WINDOW_MAX.
+#define SD_CARD_SPI_CRC_BURST         2
+#define SD_CARD_SPI_CRC_WINDOW        32
+#define SD_CARD_SPI_CLEAN_WINDOW      1024
+#define SD_CARD_SPI_CLEAN_WINDOW_MAX  (16 * SD_CARD_SPI_CLEAN_WINDOW)
+
+// Data token search window bounds, in bytes. The window is the average token
+// offset plus half again plus SD_CARD_SPI_TOKEN_WINDOW_MARGIN.
+#define SD_CARD_SPI_TOKEN_WINDOW_MIN     8
+#define SD_CARD_SPI_TOKEN_WINDOW_MARGIN  8
+
+// Block operation retry policy (templates/specs.json block_operations.retry_policy)
+#define SD_CARD_SPI_READ_MAX_RETRIES     3
+#define SD_CARD_SPI_READ_BACKOFF_MS      { 0, 5, 20 }
+#define SD_CARD_SPI_WRITE_MAX_RETRIES    2
+#define SD_CARD_SPI_WRITE_BACKOFF_MS     { 5, 50 }
+
+// Bytes clocked after a written block's data response to catch a short busy
+// without a separate poll
+#define SD_CARD_SPI_WRITE_BUSY_PROBE     8
+
+// An open CMD18 stream that no read has continued for this long is closed by
+// its idle timer
+#define SD_CARD_SPI_STREAM_IDLE_US       100000
+
+// R1 is expected within SD_CARD_SPI_NCR_MAX bytes of the command frame. A
+// fused CMD17 captures at most SD_CARD_SPI_FUSED_REPLY_MAX reply bytes.
+#define SD_CARD_SPI_NCR_MAX              8
+#define SD_CARD_SPI_FUSED_REPLY_MAX      1024
+
+// Data error token: upper three bits clear
+#define DATA_ERROR_TOKEN_MASK   0xE0
+
+// Reads of the training block at each clock step
+#define SD_CARD_SPI_TRAINING_READS    2
+
 // Maximum retries for waiting operations
 #define MAX_WAIT_RETRIES        1000000
 
-// Timeout values (in microseconds)
+// Timeout values (in microseconds). The CSD-derived read and write timeouts
+// are used when known, and never exceed these.
 #define CMD_TIMEOUT_US          100000
 #define READ_TIMEOUT_US         300000
 #define WRITE_TIMEOUT_US        600000
 
+// Card-specified timeouts: 100 times the typical access time for standard
+// capacity cards, fixed values for high capacity cards
+#define SD_READ_TIMEOUT_US      100000
+#define SD_WRITE_TIMEOUT_US     250000
+#define SDXC_WRITE_TIMEOUT_US   500000
+
+// Busy and token poller: each miss doubles the burst read per transaction up
+// to SD_CARD_SPI_POLL_BURST_MAX bytes and the stall between transactions up
+// to SD_CARD_SPI_POLL_STALL_MAX_US.
+#define SD_CARD_SPI_POLL_BURST_MAX      64
+#define SD_CARD_SPI_POLL_STALL_MAX_US   1000
+
+// Period of the timer that checks a pending write busy between requests,
+// one byte per check
+#define SD_CARD_SPI_BUSY_CHECK_US       1000
+
 // R1 Response Flags
 
 // SPI internal helpers (prototypes)
 EFI_STATUS EFIAPI SdCardSendCommandSpi(SD_CARD_PRIVATE_DATA *Private, UINT8 Command, UINT32 Argument, UINT8 *Response);
+EFI_STATUS EFIAPI SdCardSendCommandExSpi(SD_CARD_PRIVATE_DATA *Private, UINT8 Command, UINT32 Argument, UINT8 *Response, UINT8 *Trailing);
 EFI_STATUS EFIAPI SdCardWaitNotBusySpi(SD_CARD_PRIVATE_DATA *Private);
 EFI_STATUS EFIAPI SdCardReadDataBlockSpi(SD_CARD_PRIVATE_DATA *Private, UINTN Length, UINT8 *Buffer);
+EFI_STATUS EFIAPI SdCardStreamReadSpi(SD_CARD_PRIVATE_DATA *Private, UINTN BlockCount, UINT8 *Buffer);
+EFI_STATUS EFIAPI SdCardCloseStreamSpi(SD_CARD_PRIVATE_DATA *Private);
+EFI_STATUS EFIAPI SdCardCreateEventsSpi(SD_CARD_PRIVATE_DATA *Private);
+VOID EFIAPI SdCardCloseEventsSpi(SD_CARD_PRIVATE_DATA *Private);
+EFI_STATUS EFIAPI SdCardFinishWriteSpi(SD_CARD_PRIVATE_DATA *Private);
 EFI_STATUS EFIAPI SdCardWriteDataBlockSpi(SD_CARD_PRIVATE_DATA *Private, UINT8 Token, UINTN Length, CONST UINT8 *Buffer);
 EFI_STATUS EFIAPI SdCardParseCsdSpi(SD_CARD_PRIVATE_DATA *Private, UINT8 *Csd);
 EFI_STATUS EFIAPI SdCardInitializeSpi(SD_CARD_PRIVATE_DATA *Private);
+EFI_STATUS EFIAPI SdCardIdentifySpi(SD_CARD_PRIVATE_DATA *Private);
+EFI_STATUS EFIAPI SdCardPollOpCondSpi(SD_CARD_PRIVATE_DATA *Private, BOOLEAN *Ready);
+EFI_STATUS EFIAPI SdCardCompleteInitSpi(SD_CARD_PRIVATE_DATA *Private);
+EFI_STATUS EFIAPI SdCardReadRegistersSpi(SD_CARD_PRIVATE_DATA *Private);
+VOID EFIAPI SdCardStartDataClockSpi(SD_CARD_PRIVATE_DATA *Private);
+EFI_STATUS EFIAPI SdCardProbeEraseSpi(SD_CARD_PRIVATE_DATA *Private);
+EFI_STATUS EFIAPI SdCardReadCsdSpi(SD_CARD_PRIVATE_DATA *Private, UINT8 *Csd);
+EFI_STATUS EFIAPI SdCardSwitchHighSpeedSpi(SD_CARD_PRIVATE_DATA *Private);
+EFI_STATUS EFIAPI SdCardStartTrainClockSpi(SD_CARD_PRIVATE_DATA *Private, BOOLEAN *Done);
+EFI_STATUS EFIAPI SdCardTrainClockStepSpi(SD_CARD_PRIVATE_DATA *Private, BOOLEAN *Done);
+BOOLEAN EFIAPI SdCardMonitorClockSpi(SD_CARD_PRIVATE_DATA *Private, EFI_STATUS TransferStatus);
 /**
   Execute SPI data transfer.
 
@@ -1,9 +1,11 @@
 // Replace SpiLib.c with this enhanced version
 #include "SpiLib.h"
+#include "DriverLib.h"
 #include <Library/MemoryAllocationLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Protocol/SpiHc.h>
 #include <Library/DebugLib.h>
+#include <Library/PcdLib.h>
 
 /**
   Asserts the SPI chip select line.
@@ -20,6 +22,12 @@ SpiAssertCs (
     DEBUG((DEBUG_ERROR, "SpiAssertCs: Invalid parameters\n"));
     return EFI_INVALID_PARAMETER;
   }
+
+  // Queued bytes belong to the current chip select window
+  Status = SpiBatchFlush (Private);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
   
   Status = Private->SpiHcProtocol->ChipSelect(Private->SpiHcProtocol, Private->SpiPeripheral, TRUE);
   if (EFI_ERROR(Status)) {
@@ -44,6 +52,12 @@ SpiDeassertCs (
     DEBUG((DEBUG_ERROR, "SpiDeassertCs: Invalid parameters\n"));
     return EFI_INVALID_PARAMETER;
   }
+
+  // Queued bytes belong to the current chip select window
+  Status = SpiBatchFlush (Private);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
   
   Status = Private->SpiHcProtocol->ChipSelect(Private->SpiHcProtocol, Private->SpiPeripheral, FALSE);
   if (EFI_ERROR(Status)) {
@@ -84,21 +98,329 @@ SpiTransferByte (
 }
 
 /**
-  Transfers a buffer of data to and from the SPI device.
+  Reads the SPI host controller capabilities and builds the transfer planner.
+
+  Write-only transactions are used for transmit-only transfers whenever the
+  controller supports them. Read-only transactions are used for receive-only
+  transfers only if the platform also reports that the controller holds MOSI
+  high while receiving, since the card must see 0xFF on DI during reads.
+  Bulk payloads use the widest frame size the controller supports.
 **/
 EFI_STATUS
 EFIAPI
-SpiTransferBuffer (
+SpiConfigureHostController (
+  IN SD_CARD_PRIVATE_DATA *Private
+  )
+{
+  EFI_SPI_HC_PROTOCOL *SpiHc;
+  SD_CARD_SPI_PLANNER *Planner;
+
+  if (Private == NULL || Private->SpiHcProtocol == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  SpiHc   = Private->SpiHcProtocol;
+  Planner = &Private->SpiPlanner;
+
+  Planner->WriteOnly = (BOOLEAN)((SpiHc->Attributes & HC_SUPPORTS_WRITE_ONLY_OPERATIONS) != 0);
+  Planner->ReadOnly  = (BOOLEAN)((SpiHc->Attributes & HC_SUPPORTS_READ_ONLY_OPERATIONS) != 0 &&
+                                 PcdGetBool (PcdSdCardSpiMosiIdleHigh));
+
+  // A zero limit means the controller did not report one
+  Planner->MaxTransferBytes = (SpiHc->MaximumTransferBytes != 0) ? SpiHc->MaximumTransferBytes : MAX_UINT32;
+
+  Planner->FrameSizeMask = SpiHc->FrameSizeSupportMask;
+  if ((Planner->FrameSizeMask & SPI_FRAME_SIZE_BIT (32)) != 0) {
+    Planner->MaxFrameBits = 32;
+  } else if ((Planner->FrameSizeMask & SPI_FRAME_SIZE_BIT (16)) != 0) {
+    Planner->MaxFrameBits = 16;
+  } else {
+    Planner->MaxFrameBits = 8;
+  }
+
+  DEBUG((DEBUG_INFO, "SpiConfigureHostController: Attributes 0x%x, max transfer %u, frame mask 0x%x\n",
+         SpiHc->Attributes, Planner->MaxTransferBytes, Planner->FrameSizeMask));
+  DEBUG((DEBUG_INFO, "SpiConfigureHostController: write-only %d, read-only %d, max frame %u bits\n",
+         Planner->WriteOnly, Planner->ReadOnly, Planner->MaxFrameBits));
+  return EFI_SUCCESS;
+}
+
+/**
+  Switches the SPI clock, bounded by the platform limit.
+
+  The request is capped at PcdSdCardSpiMaxClockHz and recorded in the
+  peripheral's MaxClockHz, then programmed through the host controller, which
+  may pick a lower rate. The rate actually in use is kept in CurrentClockHz.
+  Anything still queued in the batch is sent at the old rate first.
+**/
+EFI_STATUS
+EFIAPI
+SpiSetClock (
+  IN SD_CARD_PRIVATE_DATA *Private,
+  IN UINT32               ClockHz
+  )
+{
+  UINT32     PlatformMaxHz;
+  UINT32     ActualHz;
+  EFI_STATUS Status;
+
+  if (Private == NULL || Private->SpiHcProtocol == NULL || Private->SpiPeripheral == NULL || ClockHz == 0) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = SpiBatchFlush (Private);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  PlatformMaxHz = PcdGet32 (PcdSdCardSpiMaxClockHz);
+  if (PlatformMaxHz != 0 && ClockHz > PlatformMaxHz) {
+    ClockHz = PlatformMaxHz;
+  }
+
+  if (ClockHz == Private->CurrentClockHz && Private->SpiPeripheral->MaxClockHz == ClockHz) {
+    return EFI_SUCCESS;
+  }
+
+  Private->SpiPeripheral->MaxClockHz = ClockHz;
+
+  ActualHz = ClockHz;
+  Status   = Private->SpiHcProtocol->Clock (Private->SpiHcProtocol, Private->SpiPeripheral, &ActualHz);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_WARN, "SpiSetClock: Controller rejected %u Hz - %r\n", ClockHz, Status));
+    return Status;
+  }
+
+  // Controllers that do not report the chosen rate leave the request in place
+  if (ActualHz == 0 || ActualHz > ClockHz) {
+    ActualHz = ClockHz;
+  }
+  Private->CurrentClockHz = ActualHz;
+
+  DEBUG((DEBUG_INFO, "SpiSetClock: Requested %u Hz, running at %u Hz\n", ClockHz, ActualHz));
+  return EFI_SUCCESS;
+}
+
+/**
+  Allocates the per-device SPI transaction arena.
+
+  The arena holds a persistent 0xFF fill region used as the transmit source for
+  receive-only transfers, a scratch region used as the receive sink for
+  transmit-only and merged transfers, and a staging region where merged or
+  frame-swapped transmit data is assembled, so the transfer path does not
+  allocate. Each region is sized to the controller's transfer limit, within
+  SD_CARD_SPI_ARENA_MIN_SIZE and SD_CARD_SPI_ARENA_MAX_SIZE.
+**/
+EFI_STATUS
+EFIAPI
+SpiArenaInitialize (
+  IN SD_CARD_PRIVATE_DATA *Private
+  )
+{
+  SD_CARD_SPI_ARENA *Arena;
+  UINT8             *Base;
+  UINTN             Size;
+
+  if (Private == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Arena = &Private->SpiArena;
+  if (Arena->FillBuffer != NULL) {
+    return EFI_SUCCESS;
+  }
+
+  Size = SD_CARD_SPI_ARENA_MAX_SIZE;
+  if (Private->SpiPlanner.MaxTransferBytes != 0 && Private->SpiPlanner.MaxTransferBytes < Size) {
+    Size = MAX (Private->SpiPlanner.MaxTransferBytes, SD_CARD_SPI_ARENA_MIN_SIZE);
+  }
+
+  Base = AllocatePool (3 * Size);
+  if (Base == NULL) {
+    DEBUG((DEBUG_ERROR, "SpiArenaInitialize: Failed to allocate %u byte arena\n", 3 * Size));
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Arena->FillBuffer    = Base;
+  Arena->ScratchBuffer = Base + Size;
+  Arena->StagingBuffer = Base + 2 * Size;
+  Arena->Size          = Size;
+  SetMem (Arena->FillBuffer, Arena->Size, 0xFF);
+  ZeroMem (&Arena->Transaction, sizeof (Arena->Transaction));
+
+  DEBUG((DEBUG_INFO, "SpiArenaInitialize: %u byte fill/scratch/staging regions at %p\n", Arena->Size, Base));
+  return EFI_SUCCESS;
+}
+
+/**
+  Releases the per-device SPI transaction arena.
+**/
+VOID
+EFIAPI
+SpiArenaFree (
+  IN SD_CARD_PRIVATE_DATA *Private
+  )
+{
+  SD_CARD_SPI_ARENA *Arena;
+
+  if (Private == NULL) {
+    return;
+  }
+
+  Arena = &Private->SpiArena;
+  if (Arena->FillBuffer != NULL) {
+    DEBUG((DEBUG_INFO, "SpiArenaFree: %lu transactions, %lu transfer-path pool allocations\n",
+           Arena->TransactionCount, Arena->PoolAllocations));
+    FreePool (Arena->FillBuffer);
+  }
+
+  ZeroMem (Arena, sizeof (*Arena));
+}
+
+/**
+  Picks the frame size for one transaction.
+
+  Frames wider than 8 bits are only used for bulk transfers whose length and
+  buffers are multiples of the frame width.
+**/
+STATIC
+UINT32
+SpiPlanFrameSize (
+  IN SD_CARD_PRIVATE_DATA *Private,
+  IN CONST UINT8          *WriteBuffer,
+  IN CONST UINT8          *ReadBuffer,
+  IN UINTN                TransferLength
+  )
+{
+  UINT32 FrameBits;
+  UINTN  FrameBytes;
+
+  if (Private->SpiPlanner.MaxFrameBits <= 8 || TransferLength < SD_CARD_SPI_WIDE_FRAME_MIN_BYTES) {
+    return 8;
+  }
+
+  for (FrameBits = Private->SpiPlanner.MaxFrameBits; FrameBits > 8; FrameBits /= 2) {
+    FrameBytes = FrameBits / 8;
+    if ((Private->SpiPlanner.FrameSizeMask & SPI_FRAME_SIZE_BIT (FrameBits)) == 0 ||
+        (TransferLength % FrameBytes) != 0 ||
+        ((UINTN)WriteBuffer % FrameBytes) != 0 ||
+        ((UINTN)ReadBuffer % FrameBytes) != 0) {
+      continue;
+    }
+    return FrameBits;
+  }
+
+  return 8;
+}
+
+/**
+  Converts between bus byte order and frame-sized host words.
+
+  The controller shifts each frame out most significant bit first, so wide
+  frames hold their bytes in reverse order on a little-endian host. When
+  Source is NULL the buffer is converted in place.
+**/
+STATIC
+VOID
+SpiSwapFrames (
+  OUT UINT8       *Destination,
+  IN  CONST UINT8 *Source OPTIONAL,
+  IN  UINTN       Length,
+  IN  UINT32      FrameBits
+  )
+{
+  UINTN  Index;
+  UINT32 Word32;
+  UINT16 Word16;
+
+  if (Source == NULL) {
+    Source = Destination;
+  }
+
+  if (FrameBits == 32) {
+    for (Index = 0; Index < Length; Index += 4) {
+      Word32 = SwapBytes32 (*(CONST UINT32 *)(Source + Index));
+      *(UINT32 *)(Destination + Index) = Word32;
+    }
+  } else if (FrameBits == 16) {
+    for (Index = 0; Index < Length; Index += 2) {
+      Word16 = SwapBytes16 (*(CONST UINT16 *)(Source + Index));
+      *(UINT16 *)(Destination + Index) = Word16;
+    }
+  } else if (Destination != Source) {
+    CopyMem (Destination, Source, Length);
+  }
+}
+
+/**
+  Issues one transaction using the arena's transaction descriptor.
+**/
+STATIC
+EFI_STATUS
+SpiSubmitTransaction (
+  IN SD_CARD_PRIVATE_DATA     *Private,
+  IN EFI_SPI_TRANSACTION_TYPE TransactionType,
+  IN UINT8                    *WriteBuffer,
+  IN UINT8                    *ReadBuffer,
+  IN UINTN                    TransferLength,
+  IN UINT32                   FrameBits
+  )
+{
+  EFI_SPI_BUS_TRANSACTION *Transaction;
+  EFI_STATUS              Status;
+
+  Transaction = &Private->SpiArena.Transaction;
+
+  Transaction->SpiPeripheral     = Private->SpiPeripheral;
+  Transaction->TransactionType   = TransactionType;
+  Transaction->DebugTransaction  = FALSE;
+  Transaction->BusWidth          = 1;
+  Transaction->FrameSize         = FrameBits;
+  Transaction->WriteBytes        = (TransactionType == SPI_TRANSACTION_READ_ONLY) ? 0 : (UINT32)TransferLength;
+  Transaction->WriteBuffer       = (TransactionType == SPI_TRANSACTION_READ_ONLY) ? NULL : WriteBuffer;
+  Transaction->ReadBytes         = (TransactionType == SPI_TRANSACTION_WRITE_ONLY) ? 0 : (UINT32)TransferLength;
+  Transaction->ReadBuffer        = (TransactionType == SPI_TRANSACTION_WRITE_ONLY) ? NULL : ReadBuffer;
+
+  Private->SpiArena.TransactionCount++;
+
+  Status = Private->SpiHcProtocol->Transaction (Private->SpiHcProtocol, Transaction);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_ERROR, "SpiTransferBuffer: Transaction type %d failed - %r\n", TransactionType, Status));
+  }
+
+  return Status;
+}
+
+/**
+  Transfers a buffer of data to and from the SPI device, bypassing the batch.
+
+  The transfer is planned against the host controller's capabilities: it is
+  split at the controller's maximum transfer size, bulk chunks use the widest
+  legal frame size, and on controllers that support them transmit-only and
+  receive-only transfers are issued as write-only and read-only transactions.
+  Otherwise a NULL WriteBuffer clocks out 0xFF from the arena fill region and a
+  NULL ReadBuffer discards the received bytes into the arena scratch region;
+  such chunks are additionally limited to the arena size. If the arena has not
+  been set up, a temporary pool buffer is used instead and counted.
+**/
+STATIC
+EFI_STATUS
+SpiTransferPlanned (
   IN     SD_CARD_PRIVATE_DATA *Private,
   IN     CONST UINT8          *WriteBuffer,
   OUT    UINT8                *ReadBuffer,
   IN     UINTN                TransferLength
   )
 {
-  EFI_SPI_BUS_TRANSACTION Transaction;
-  UINT8                   *LocalWriteBuffer;
-  BOOLEAN                 FreeBuffer;
-  EFI_STATUS              Status;
+  SD_CARD_SPI_ARENA        *Arena;
+  SD_CARD_SPI_PLANNER      *Planner;
+  EFI_SPI_TRANSACTION_TYPE TransactionType;
+  UINT8                    *LocalWriteBuffer;
+  UINT8                    *LocalReadBuffer;
+  UINT8                    *PoolBuffer;
+  UINTN                    ChunkLength;
+  UINT32                   FrameBits;
+  EFI_STATUS               Status;
 
   if (Private == NULL || Private->SpiHcProtocol == NULL) {
     DEBUG((DEBUG_ERROR, "SpiTransferBuffer: Invalid parameters\n"));
@@ -110,39 +432,357 @@ SpiTransferBuffer (
     return EFI_INVALID_PARAMETER;
   }
 
-  ZeroMem (&Transaction, sizeof (Transaction));
-  FreeBuffer = FALSE;
+  Arena      = &Private->SpiArena;
+  Planner    = &Private->SpiPlanner;
+  PoolBuffer = NULL;
+
+  Status = EFI_SUCCESS;
+  while (TransferLength > 0) {
+    ChunkLength = MIN (TransferLength, Planner->MaxTransferBytes);
+
+    if (ReadBuffer == NULL && Planner->WriteOnly) {
+      TransactionType  = SPI_TRANSACTION_WRITE_ONLY;
+      LocalWriteBuffer = (UINT8 *)WriteBuffer;
+      LocalReadBuffer  = NULL;
+    } else if (WriteBuffer == NULL && Planner->ReadOnly) {
+      TransactionType  = SPI_TRANSACTION_READ_ONLY;
+      LocalWriteBuffer = NULL;
+      LocalReadBuffer  = ReadBuffer;
+    } else {
+      TransactionType  = SPI_TRANSACTION_FULL_DUPLEX;
+      LocalWriteBuffer = (UINT8 *)WriteBuffer;
+      LocalReadBuffer  = ReadBuffer;
+      if (WriteBuffer == NULL && Arena->FillBuffer == NULL) {
+        //
+        // No arena yet; fall back to a temporary fill buffer.
+        //
+        PoolBuffer = AllocatePool (TransferLength);
+        if (PoolBuffer == NULL) {
+          DEBUG((DEBUG_ERROR, "SpiTransferBuffer: Failed to allocate write buffer\n"));
+          return EFI_OUT_OF_RESOURCES;
+        }
+        Arena->PoolAllocations++;
+        SetMem (PoolBuffer, TransferLength, 0xFF);
+        WriteBuffer      = PoolBuffer;
+        LocalWriteBuffer = PoolBuffer;
+      } else if (WriteBuffer == NULL) {
+        LocalWriteBuffer = Arena->FillBuffer;
+        ChunkLength      = MIN (ChunkLength, Arena->Size);
+      }
+      if (ReadBuffer == NULL && Arena->ScratchBuffer != NULL) {
+        LocalReadBuffer = Arena->ScratchBuffer;
+        ChunkLength     = MIN (ChunkLength, Arena->Size);
+      }
+    }
+
+    FrameBits = SpiPlanFrameSize (Private, LocalWriteBuffer, LocalReadBuffer, ChunkLength);
+    if (FrameBits > 8 && LocalWriteBuffer != NULL && LocalWriteBuffer != Arena->FillBuffer &&
+        WriteBuffer != PoolBuffer) {
+      if (Arena->StagingBuffer == NULL) {
+        FrameBits = 8;
+      } else {
+        // Caller data is constant; stage it in frame order
+        ChunkLength = MIN (ChunkLength, Arena->Size);
+        FrameBits   = SpiPlanFrameSize (Private, Arena->StagingBuffer, LocalReadBuffer, ChunkLength);
+        SpiSwapFrames (Arena->StagingBuffer, WriteBuffer, ChunkLength, FrameBits);
+        LocalWriteBuffer = Arena->StagingBuffer;
+      }
+    }
+
+    Status = SpiSubmitTransaction (Private, TransactionType, LocalWriteBuffer, LocalReadBuffer, ChunkLength, FrameBits);
+    if (TransactionType != SPI_TRANSACTION_FULL_DUPLEX &&
+        (Status == EFI_UNSUPPORTED || Status == EFI_INVALID_PARAMETER)) {
+      DEBUG((DEBUG_WARN, "SpiTransferBuffer: Controller rejected transaction type %d, using full duplex\n",
+             TransactionType));
+      if (TransactionType == SPI_TRANSACTION_WRITE_ONLY) {
+        Planner->WriteOnly = FALSE;
+      } else {
+        Planner->ReadOnly = FALSE;
+      }
+      continue;
+    }
+    if (EFI_ERROR(Status)) {
+      break;
+    }
 
-  if (WriteBuffer == NULL) {
-    LocalWriteBuffer = AllocatePool (TransferLength);
-    if (LocalWriteBuffer == NULL) {
-      DEBUG((DEBUG_ERROR, "SpiTransferBuffer: Failed to allocate write buffer\n"));
-      return EFI_OUT_OF_RESOURCES;
+    if (FrameBits > 8 && ReadBuffer != NULL) {
+      SpiSwapFrames (ReadBuffer, NULL, ChunkLength, FrameBits);
+    }
+
+    if (WriteBuffer != NULL) {
+      WriteBuffer += ChunkLength;
+    }
+    if (ReadBuffer != NULL) {
+      ReadBuffer += ChunkLength;
     }
-    SetMem (LocalWriteBuffer, TransferLength, 0xFF);
-    FreeBuffer = TRUE;
+    TransferLength -= ChunkLength;
+  }
+
+  if (PoolBuffer != NULL) {
+    FreePool (PoolBuffer);
+  }
+
+  return Status;
+}
+
+/**
+  Returns the largest number of bytes the batch can hold in one transaction.
+**/
+STATIC
+UINTN
+SpiBatchLimit (
+  IN SD_CARD_PRIVATE_DATA *Private
+  )
+{
+  if (Private->SpiArena.StagingBuffer == NULL) {
+    return 0;
+  }
+
+  return MIN (Private->SpiArena.Size, Private->SpiPlanner.MaxTransferBytes);
+}
+
+/**
+  Drops everything queued in the batch without sending it. Used when queuing
+  part of a transaction failed, so the rest is not sent on its own.
+**/
+VOID
+EFIAPI
+SpiBatchDiscard (
+  IN SD_CARD_PRIVATE_DATA *Private
+  )
+{
+  Private->SpiArena.BatchLength  = 0;
+  Private->SpiArena.CaptureCount = 0;
+}
+
+/**
+  Sends everything queued in the batch as a single transaction.
+
+  Deferred receive captures are copied out of the arena scratch region into
+  the callers' buffers once the transaction completes. Nothing is sent if the
+  batch is empty.
+**/
+EFI_STATUS
+EFIAPI
+SpiBatchFlush (
+  IN SD_CARD_PRIVATE_DATA *Private
+  )
+{
+  SD_CARD_SPI_ARENA   *Arena;
+  SD_CARD_SPI_CAPTURE *Capture;
+  UINTN               Length;
+  UINTN               Index;
+  EFI_STATUS          Status;
+
+  if (Private == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Arena = &Private->SpiArena;
+  if (Arena->BatchLength == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Length             = Arena->BatchLength;
+  Arena->BatchLength = 0;
+
+  Status = SpiTransferPlanned (
+             Private,
+             Arena->StagingBuffer,
+             (Arena->CaptureCount != 0) ? Arena->ScratchBuffer : NULL,
+             Length
+             );
+  if (!EFI_ERROR(Status)) {
+    for (Index = 0; Index < Arena->CaptureCount; Index++) {
+      Capture = &Arena->Captures[Index];
+      if (Capture->Crc != NULL) {
+        *Capture->Crc = SdCardCopyCrc16 (*Capture->Crc, Capture->Buffer, Arena->ScratchBuffer + Capture->Offset, Capture->Length);
+      } else {
+        CopyMem (Capture->Buffer, Arena->ScratchBuffer + Capture->Offset, Capture->Length);
+      }
+    }
+  }
+
+  Arena->CaptureCount = 0;
+  return Status;
+}
+
+/**
+  Appends a transfer to the batch without touching the bus.
+
+  The transmit bytes are copied into the arena staging region, so WriteBuffer
+  may be reused as soon as this returns; a NULL WriteBuffer queues 0xFF. If
+  ReadBuffer is not NULL the received bytes are delivered to it by the next
+  SpiBatchFlush, so it must remain valid until then. The batch is flushed
+  early when the new transfer would not fit into one transaction, and a
+  transfer larger than the batch itself is sent directly.
+
+  If Crc is not NULL the payload is folded into it as it is copied: the
+  transmit bytes while they are staged, or the received bytes while the
+  flush delivers them. A transfer sent directly is checksummed after it.
+**/
+EFI_STATUS
+EFIAPI
+SpiBatchQueueCrc16 (
+  IN     SD_CARD_PRIVATE_DATA *Private,
+  IN     CONST UINT8          *WriteBuffer OPTIONAL,
+  OUT    UINT8                *ReadBuffer OPTIONAL,
+  IN     UINTN                Length,
+  IN OUT UINT16               *Crc OPTIONAL
+  )
+{
+  SD_CARD_SPI_ARENA   *Arena;
+  SD_CARD_SPI_CAPTURE *Capture;
+  UINTN               Limit;
+  UINTN               ChunkLength;
+  EFI_STATUS          Status;
+
+  if (Private == NULL || Length == 0) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Arena = &Private->SpiArena;
+  Limit = SpiBatchLimit (Private);
+
+  if (Length > Limit) {
+    Status = SpiBatchFlush (Private);
+    if (EFI_ERROR(Status)) {
+      return Status;
+    }
+    if (WriteBuffer != NULL || ReadBuffer != NULL || Limit == 0) {
+      Status = SpiTransferPlanned (Private, WriteBuffer, ReadBuffer, Length);
+      if (!EFI_ERROR(Status) && Crc != NULL) {
+        *Crc = SdCardUpdateCrc16 (*Crc, (WriteBuffer != NULL) ? WriteBuffer : ReadBuffer, Length);
+      }
+      return Status;
+    }
+
+    // Idle clocks with nothing to keep; send them in batch-sized pieces
+    while (Length > 0) {
+      ChunkLength = MIN (Length, Limit);
+      SetMem (Arena->StagingBuffer, ChunkLength, 0xFF);
+      Arena->BatchLength = ChunkLength;
+      Status = SpiBatchFlush (Private);
+      if (EFI_ERROR(Status)) {
+        return Status;
+      }
+      Length -= ChunkLength;
+    }
+    return EFI_SUCCESS;
+  }
+
+  if (Arena->BatchLength + Length > Limit ||
+      (ReadBuffer != NULL && Arena->CaptureCount == SD_CARD_SPI_MAX_CAPTURES)) {
+    Status = SpiBatchFlush (Private);
+    if (EFI_ERROR(Status)) {
+      return Status;
+    }
+  }
+
+  if (WriteBuffer != NULL && Crc != NULL) {
+    *Crc = SdCardCopyCrc16 (*Crc, Arena->StagingBuffer + Arena->BatchLength, WriteBuffer, Length);
+  } else if (WriteBuffer != NULL) {
+    CopyMem (Arena->StagingBuffer + Arena->BatchLength, WriteBuffer, Length);
   } else {
-    LocalWriteBuffer = (UINT8 *)WriteBuffer;
+    SetMem (Arena->StagingBuffer + Arena->BatchLength, Length, 0xFF);
+  }
+
+  if (ReadBuffer != NULL) {
+    Capture         = &Arena->Captures[Arena->CaptureCount++];
+    Capture->Buffer = ReadBuffer;
+    Capture->Offset = Arena->BatchLength;
+    Capture->Length = Length;
+    Capture->Crc    = (WriteBuffer == NULL) ? Crc : NULL;
+  }
+
+  Arena->BatchLength += Length;
+  return EFI_SUCCESS;
+}
+
+/**
+  Appends a transfer to the batch without touching the bus.
+**/
+EFI_STATUS
+EFIAPI
+SpiBatchQueue (
+  IN     SD_CARD_PRIVATE_DATA *Private,
+  IN     CONST UINT8          *WriteBuffer OPTIONAL,
+  OUT    UINT8                *ReadBuffer OPTIONAL,
+  IN     UINTN                Length
+  )
+{
+  return SpiBatchQueueCrc16 (Private, WriteBuffer, ReadBuffer, Length, NULL);
+}
+
+/**
+  Transfers a buffer of data to and from the SPI device.
+
+  Anything already queued in the batch goes out first. When the transfer fits
+  behind the queued bytes it is sent in the same transaction, so a queued
+  command or token and the first poll of its reply share one round trip.
+**/
+EFI_STATUS
+EFIAPI
+SpiTransferBuffer (
+  IN     SD_CARD_PRIVATE_DATA *Private,
+  IN     CONST UINT8          *WriteBuffer,
+  OUT    UINT8                *ReadBuffer,
+  IN     UINTN                TransferLength
+  )
+{
+  EFI_STATUS Status;
+
+  if (Private == NULL || Private->SpiHcProtocol == NULL) {
+    DEBUG((DEBUG_ERROR, "SpiTransferBuffer: Invalid parameters\n"));
+    return EFI_INVALID_PARAMETER;
   }
 
-  Transaction.SpiPeripheral     = Private->SpiPeripheral;
-  Transaction.TransactionType   = SPI_TRANSACTION_FULL_DUPLEX;
-  Transaction.DebugTransaction  = FALSE;
-  Transaction.BusWidth          = 1;
-  Transaction.FrameSize         = 8;
-  Transaction.WriteBytes        = TransferLength;
-  Transaction.WriteBuffer       = LocalWriteBuffer;
-  Transaction.ReadBytes         = TransferLength;
-  Transaction.ReadBuffer        = ReadBuffer;
+  if (Private->SpiArena.BatchLength != 0 && TransferLength != 0 &&
+      Private->SpiArena.BatchLength + TransferLength <= SpiBatchLimit (Private)) {
+    Status = SpiBatchQueue (Private, WriteBuffer, ReadBuffer, TransferLength);
+    if (EFI_ERROR(Status)) {
+      return Status;
+    }
+    return SpiBatchFlush (Private);
+  }
 
-  Status = Private->SpiHcProtocol->Transaction (Private->SpiHcProtocol, &Transaction);
+  Status = SpiBatchFlush (Private);
   if (EFI_ERROR(Status)) {
-    DEBUG((DEBUG_ERROR, "SpiTransferBuffer: Transaction failed - %r\n", Status));
+    return Status;
+  }
+
+  return SpiTransferPlanned (Private, WriteBuffer, ReadBuffer, TransferLength);
+}
+
+/**
+  Transfers a list of segments, merging adjacent segments.
+
+  The segments are queued on the batch and flushed, so consecutive segments
+  share a transaction as long as their combined length fits both the
+  controller's maximum transfer size and the arena.
+**/
+EFI_STATUS
+EFIAPI
+SpiTransferSegments (
+  IN     SD_CARD_PRIVATE_DATA *Private,
+  IN OUT SD_CARD_SPI_SEGMENT  *Segments,
+  IN     UINTN                SegmentCount
+  )
+{
+  UINTN      Index;
+  EFI_STATUS Status;
+
+  if (Private == NULL || (Segments == NULL && SegmentCount != 0)) {
+    return EFI_INVALID_PARAMETER;
   }
 
-  if (FreeBuffer) {
-    FreePool (LocalWriteBuffer);
+  for (Index = 0; Index < SegmentCount; Index++) {
+    Status = SpiBatchQueue (Private, Segments[Index].WriteBuffer, Segments[Index].ReadBuffer, Segments[Index].Length);
+    if (EFI_ERROR(Status)) {
+      SpiBatchDiscard (Private);
+      return Status;
+    }
   }
 
-  return Status;
-}
\ No newline at end of file
+  return SpiBatchFlush (Private);
+}
@@ -5,6 +5,137 @@
 #include <Protocol/SpiHc.h>
 #include "SdCardDxe.h"
 
+//
+// Bounds for each SPI arena region. The regions are sized to the host
+// controller's maximum transfer size within these limits; transfers without a
+// caller-supplied transmit or receive buffer are chunked to the region size.
+//
+#define SD_CARD_SPI_ARENA_MIN_SIZE  4096
+#define SD_CARD_SPI_ARENA_MAX_SIZE  32768
+
+//
+// Transfers shorter than this always use 8-bit frames
+//
+#define SD_CARD_SPI_WIDE_FRAME_MIN_BYTES  64
+
+//
+// FrameSizeSupportMask bit for an N-bit frame
+//
+#define SPI_FRAME_SIZE_BIT(Bits)  (1U << ((Bits) - 1))
+
+//
+// One piece of a vectored SPI transfer. A NULL WriteBuffer clocks out 0xFF
+// and a NULL ReadBuffer discards the received bytes.
+//
+typedef struct {
+  CONST UINT8 *WriteBuffer;
+  UINT8       *ReadBuffer;
+  UINTN       Length;
+} SD_CARD_SPI_SEGMENT;
+
+/**
+  Allocates the per-device SPI transaction arena.
+  @param[in] Private  SD card private data
+  @return EFI_STATUS
+**/
+EFI_STATUS
+EFIAPI
+SpiArenaInitialize (
+  IN SD_CARD_PRIVATE_DATA *Private
+  );
+
+/**
+  Reads the SPI host controller capabilities and builds the transfer planner.
+  @param[in] Private  SD card private data
+  @return EFI_STATUS
+**/
+EFI_STATUS
+EFIAPI
+SpiConfigureHostController (
+  IN SD_CARD_PRIVATE_DATA *Private
+  );
+
+/**
+  Releases the per-device SPI transaction arena.
+  @param[in] Private  SD card private data
+**/
+VOID
+EFIAPI
+SpiArenaFree (
+  IN SD_CARD_PRIVATE_DATA *Private
+  );
+
+/**
+  Appends a transfer to the batch; received bytes arrive at the next flush.
+  @param[in]  Private      SD card private data
+  @param[in]  WriteBuffer  Bytes to transmit, or NULL to clock out 0xFF
+  @param[out] ReadBuffer   Receive buffer, or NULL to discard
+  @param[in]  Length       Number of bytes
+  @return EFI_STATUS
+**/
+EFI_STATUS
+EFIAPI
+SpiBatchQueue (
+  IN     SD_CARD_PRIVATE_DATA *Private,
+  IN     CONST UINT8          *WriteBuffer OPTIONAL,
+  OUT    UINT8                *ReadBuffer OPTIONAL,
+  IN     UINTN                Length
+  );
+
+/**
+  Appends a transfer to the batch and folds its payload into a CRC16 as it
+  is copied.
+  @param[in]      Private      SD card private data
+  @param[in]      WriteBuffer  Bytes to transmit and checksum, or NULL
+  @param[out]     ReadBuffer   Receive buffer; checksummed if WriteBuffer is NULL
+  @param[in]      Length       Number of bytes
+  @param[in, out] Crc          Running CRC16; received bytes update it at the flush
+  @return EFI_STATUS
+**/
+EFI_STATUS
+EFIAPI
+SpiBatchQueueCrc16 (
+  IN     SD_CARD_PRIVATE_DATA *Private,
+  IN     CONST UINT8          *WriteBuffer OPTIONAL,
+  OUT    UINT8                *ReadBuffer OPTIONAL,
+  IN     UINTN                Length,
+  IN OUT UINT16               *Crc OPTIONAL
+  );
+
+/**
+  Drops everything queued in the batch without sending it.
+  @param[in] Private  SD card private data
+**/
+VOID
+EFIAPI
+SpiBatchDiscard (
+  IN SD_CARD_PRIVATE_DATA *Private
+  );
+
+/**
+  Sends everything queued in the batch as a single transaction.
+  @param[in] Private  SD card private data
+  @return EFI_STATUS
+**/
+EFI_STATUS
+EFIAPI
+SpiBatchFlush (
+  IN SD_CARD_PRIVATE_DATA *Private
+  );
+
+/**
+  Switches the SPI clock, bounded by the platform limit.
+  @param[in] Private  SD card private data
+  @param[in] ClockHz  Requested clock frequency in Hz
+  @return EFI_STATUS
+**/
+EFI_STATUS
+EFIAPI
+SpiSetClock (
+  IN SD_CARD_PRIVATE_DATA *Private,
+  IN UINT32               ClockHz
+  );
+
 EFI_STATUS
 EFIAPI
 SpiAssertCs (
@@ -34,4 +165,12 @@ SpiTransferBuffer (
   IN     UINTN                TransferLength
   );
 
+EFI_STATUS
+EFIAPI
+SpiTransferSegments (
+  IN     SD_CARD_PRIVATE_DATA *Private,
+  IN OUT SD_CARD_SPI_SEGMENT  *Segments,
+  IN     UINTN                SegmentCount
+  );
+
 #endif // __SPI_LIB_H__
\ No newline at end of file